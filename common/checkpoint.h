@@ -0,0 +1,108 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Helpers for the simulator snapshots written by predictors and cache_sim.
+//
+// A snapshot is a 4 byte magic, a version byte and then whatever the
+// simulator writes with the helpers below, all in host byte order. Readers
+// check the stream state once at the end rather than after every field.
+// Snapshots are always files, which lets readers bound stored lengths by
+// the bytes left in the file.
+
+const uint8_t CHECKPOINT_VERSION = 1;
+
+inline void writeCheckpointHeader(std::ostream& out, const char magic[4]) {
+    out.write(magic, 4);
+    out.put(CHECKPOINT_VERSION);
+}
+
+inline bool readCheckpointHeader(std::istream& in, const char magic[4]) {
+    char buf[4];
+    if (!in.read(buf, 4) || memcmp(buf, magic, 4) != 0) return false;
+    return in.get() == CHECKPOINT_VERSION;
+}
+
+// Writes the header and then calls write(out) on a temporary file, renamed over filename at the end
+// so a run killed while saving keeps the previous snapshot. Returns false if writing or renaming failed.
+template <typename Writer>
+inline bool writeCheckpointFile(const std::string& filename, const char magic[4], Writer write) {
+    std::string temp = filename + ".tmp";
+    std::ofstream out(temp.c_str(), std::ios::binary);
+
+    writeCheckpointHeader(out, magic);
+    write(out);
+    out.close();
+    return !out.fail() && rename(temp.c_str(), filename.c_str()) == 0;
+}
+
+// Sets the failbit unless at least bytes are left to read, so a damaged length is rejected before anything is allocated for it
+inline bool checkRemaining(std::istream& in, uint64_t bytes) {
+    std::streampos pos = in.tellg();
+    std::streampos end = pos;
+
+    if (pos != std::streampos(-1)) {
+        in.seekg(0, std::ios::end);
+        end = in.tellg();
+        in.seekg(pos);
+    }
+    if (pos == std::streampos(-1) || end == std::streampos(-1) || (uint64_t)(end - pos) < bytes) {
+        in.setstate(std::ios::failbit);
+        return false;
+    }
+    return true;
+}
+
+template <typename T>
+inline void writeValue(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+inline void readValue(std::istream& in, T& value) {
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+}
+
+// Vectors are written as their length followed by the elements, stored as Stored to keep small counters small
+template <typename Stored, typename T>
+inline void writeVector(std::ostream& out, const std::vector<T>& v) {
+    writeValue(out, (uint64_t)v.size());
+    for (size_t i = 0; i < v.size(); i++) writeValue(out, (Stored)v[i]);
+}
+
+template <typename Stored, typename T>
+inline void readVector(std::istream& in, std::vector<T>& v) {
+    uint64_t n = 0;
+    readValue(in, n);
+    if (!in || n > UINT64_MAX / sizeof(Stored) || !checkRemaining(in, n * sizeof(Stored))) return;
+
+    v.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        Stored value;
+        readValue(in, value);
+        v[i] = (T)value;
+    }
+}
+
+inline void writeString(std::ostream& out, const std::string& s) {
+    writeValue(out, (uint32_t)s.size());
+    out.write(s.data(), s.size());
+}
+
+inline void readString(std::istream& in, std::string& s) {
+    uint32_t n = 0;
+    readValue(in, n);
+    if (!in || !checkRemaining(in, n)) return;
+
+    s.resize(n);
+    in.read(&s[0], n);
+}
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,187 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// Hot path instrumentation for the simulators, compiled in with -DPROFILE
+// (make PROFILE=1) and compiled out entirely otherwise.
+//
+//   PROFILE_SCOPE(name)            time the rest of the block as phase name
+//   PROFILE_SCOPE_EVENTS(name, n)  same, also crediting n simulated events to the phase
+//   PROFILE_PHASE(name, n)         like PROFILE_SCOPE_EVENTS, but ended early by PROFILE_PHASE_END(),
+//                                  for a phase followed by output in the same function
+//   PROFILE_COUNT(name, n)         add n to an event counter, cheap enough for per-lookup use
+//   PROFILE_REPORT()               write the JSON summary, to the file named by the
+//                                  SIM_PROFILE environment variable or else to stderr
+//
+// With -DPROFILE_PERF as well (make PROFILE=perf, Linux only) each phase also
+// collects CPU cycles and cache misses through perf_event_open. If the counters
+// cannot be opened, for example under a restrictive perf_event_paranoid, the
+// summary says so and reports time only.
+
+#ifdef PROFILE
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+#ifdef PROFILE_PERF
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+struct profilePhase {
+    uint64_t calls = 0;
+    uint64_t events = 0;
+    uint64_t nanoseconds = 0;
+    uint64_t cycles = 0;
+    uint64_t cacheMisses = 0;
+};
+
+class Profiler {
+    public:
+        static Profiler& instance() {
+            static Profiler profiler;
+            return profiler;
+        }
+
+        profilePhase& phase(const std::string& name) { return this->phases[name]; }
+        uint64_t& counter(const std::string& name) { return this->counters[name]; }
+
+        // Reads the hardware counters, false if they are not available
+        bool readPerf(uint64_t& cycles, uint64_t& cacheMisses) {
+#ifdef PROFILE_PERF
+            if (this->cyclesFd < 0 || this->missesFd < 0) return false;
+            return read(this->cyclesFd, &cycles, sizeof(cycles)) == sizeof(cycles)
+                && read(this->missesFd, &cacheMisses, sizeof(cacheMisses)) == sizeof(cacheMisses);
+#else
+            (void)cycles;
+            (void)cacheMisses;
+            return false;
+#endif
+        }
+
+        void report() {
+            const char* path = getenv("SIM_PROFILE");
+            std::ofstream file;
+            if (path) file.open(path);
+            std::ostream& out = path && file ? file : std::cerr;
+
+            out << "{\"perf\": " << (this->hasPerf() ? "true" : "false") << ", \"phases\": {";
+            for (std::map<std::string, profilePhase>::const_iterator it = this->phases.begin(); it != this->phases.end(); ++it) {
+                const profilePhase& p = it->second;
+                out << (it == this->phases.begin() ? "" : ", ") << "\"" << it->first << "\": {\"calls\": " << p.calls
+                    << ", \"events\": " << p.events << ", \"ns\": " << p.nanoseconds;
+                if (this->hasPerf()) out << ", \"cycles\": " << p.cycles << ", \"cache_misses\": " << p.cacheMisses;
+                if (p.events > 0) {
+                    out << ", \"ns_per_event\": " << (double)p.nanoseconds / p.events;
+                    if (this->hasPerf()) {
+                        out << ", \"cycles_per_event\": " << (double)p.cycles / p.events
+                            << ", \"cache_misses_per_event\": " << (double)p.cacheMisses / p.events;
+                    }
+                }
+                out << "}";
+            }
+            out << "}, \"counters\": {";
+            for (std::map<std::string, uint64_t>::const_iterator it = this->counters.begin(); it != this->counters.end(); ++it) {
+                out << (it == this->counters.begin() ? "" : ", ") << "\"" << it->first << "\": " << it->second;
+            }
+            out << "}}" << std::endl;
+        }
+
+    private:
+        Profiler() {
+#ifdef PROFILE_PERF
+            this->cyclesFd = openCounter(PERF_COUNT_HW_CPU_CYCLES);
+            this->missesFd = openCounter(PERF_COUNT_HW_CACHE_MISSES);
+#endif
+        }
+
+        bool hasPerf() {
+            uint64_t cycles, cacheMisses;
+            return readPerf(cycles, cacheMisses);
+        }
+
+#ifdef PROFILE_PERF
+        // Counts user space events of this process on any CPU
+        static int openCounter(uint64_t config) {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = config;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+
+        int cyclesFd;
+        int missesFd;
+#endif
+
+        std::map<std::string, profilePhase> phases;
+        std::map<std::string, uint64_t> counters;
+};
+
+// Adds the time (and hardware counts) between construction and stop() or destruction to a phase
+class ProfileTimer {
+    public:
+        ProfileTimer(const std::string& name, uint64_t events = 0) : phase(Profiler::instance().phase(name)) {
+            this->phase.calls++;
+            this->phase.events += events;
+            this->perf = Profiler::instance().readPerf(this->cycles, this->cacheMisses);
+            this->start = std::chrono::steady_clock::now();
+        }
+
+        ~ProfileTimer() {
+            stop();
+        }
+
+        void stop() {
+            if (this->stopped) return;
+            this->stopped = true;
+
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+            this->phase.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(end - this->start).count();
+
+            uint64_t cycles, cacheMisses;
+            if (this->perf && Profiler::instance().readPerf(cycles, cacheMisses)) {
+                this->phase.cycles += cycles - this->cycles;
+                this->phase.cacheMisses += cacheMisses - this->cacheMisses;
+            }
+        }
+
+    private:
+        profilePhase& phase;
+        std::chrono::steady_clock::time_point start;
+        bool perf;
+        bool stopped = false;
+        uint64_t cycles;
+        uint64_t cacheMisses;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ProfileTimer PROFILE_CONCAT(profileTimer, __LINE__)(name)
+#define PROFILE_SCOPE_EVENTS(name, n) ProfileTimer PROFILE_CONCAT(profileTimer, __LINE__)(name, n)
+#define PROFILE_PHASE(name, n) ProfileTimer profilePhaseTimer(name, n)
+#define PROFILE_PHASE_END() profilePhaseTimer.stop()
+#define PROFILE_COUNT(name, n) do { static uint64_t& profileCounter = Profiler::instance().counter(name); profileCounter += (n); } while (0)
+#define PROFILE_REPORT() Profiler::instance().report()
+
+#else
+
+#define PROFILE_SCOPE(name) do { } while (0)
+#define PROFILE_SCOPE_EVENTS(name, n) do { } while (0)
+#define PROFILE_PHASE(name, n) do { } while (0)
+#define PROFILE_PHASE_END() do { } while (0)
+#define PROFILE_COUNT(name, n) do { } while (0)
+#define PROFILE_REPORT() do { } while (0)
+
+#endif // PROFILE
+
+#endif // PROFILE_H
@@ -0,0 +1,103 @@
+#ifndef TRACEIO_H
+#define TRACEIO_H
+
+#include <stdint.h>
+#include <string.h>
+#include <iostream>
+
+// Binary trace format shared by tracegen, predictors and cache_sim.
+//
+// A binary trace is a 16 byte header followed by fixed size records, all in
+// host byte order (little-endian on every machine we run the simulators on).
+//
+//   header:  "CSTR" | version (1 byte) | kind (1 byte) | 2 reserved | 4 reserved | record count (8 bytes)
+//   memory:  8 bytes, bit 63 set for a store ('S'), clear for a load ('L'), low bits are the address
+//   branch:  16 bytes, address with bit 63 set when taken, followed by the target address
+//
+// Text traces never start with "CSTR", so readers can sniff the first bytes
+// and fall back to the text parser.
+
+const char TRACE_MAGIC[4] = {'C', 'S', 'T', 'R'};
+const uint8_t TRACE_VERSION = 1;
+const uint64_t TRACE_FLAG_BIT = 1ULL << 63;
+
+enum traceKind {
+    TRACE_MEMORY = 0,
+    TRACE_BRANCH = 1
+};
+
+struct traceHeader {
+    char magic[4];
+    uint8_t version;
+    uint8_t kind;
+    uint8_t reserved[6];
+    uint64_t count;
+};
+
+struct memoryRecord {
+    uint64_t word;
+};
+
+struct branchRecord {
+    uint64_t word;
+    uint64_t target;
+};
+
+// Returns true if the stream starts with the binary trace magic; the stream position is left untouched
+inline bool isBinaryTrace(std::istream& in) {
+    char magic[4];
+    std::streampos start = in.tellg();
+    bool binary = in.read(magic, sizeof(magic)) && memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0;
+    in.clear();
+    in.seekg(start);
+    return binary;
+}
+
+// Reads and validates the header, returns false if it is not a trace of the expected kind
+inline bool readTraceHeader(std::istream& in, traceKind kind, traceHeader& header) {
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    return memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) == 0 && header.version == TRACE_VERSION && header.kind == kind;
+}
+
+inline void writeTraceHeader(std::ostream& out, traceKind kind, uint64_t count) {
+    traceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.kind = kind;
+    header.count = count;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+inline memoryRecord packMemory(char type, unsigned long long address) {
+    memoryRecord r;
+    r.word = (address & ~TRACE_FLAG_BIT) | (type == 'S' ? TRACE_FLAG_BIT : 0);
+    return r;
+}
+
+inline void unpackMemory(const memoryRecord& r, char& type, unsigned long long& address) {
+    type = (r.word & TRACE_FLAG_BIT) ? 'S' : 'L';
+    address = r.word & ~TRACE_FLAG_BIT;
+}
+
+inline branchRecord packBranch(unsigned long long address, bool taken, unsigned long long target) {
+    branchRecord r;
+    r.word = (address & ~TRACE_FLAG_BIT) | (taken ? TRACE_FLAG_BIT : 0);
+    r.target = target;
+    return r;
+}
+
+inline void unpackBranch(const branchRecord& r, unsigned long long& address, bool& taken, unsigned long long& target) {
+    taken = (r.word & TRACE_FLAG_BIT) != 0;
+    address = r.word & ~TRACE_FLAG_BIT;
+    target = r.target;
+}
+
+// Reads up to max records into buf, returns the number of records read
+template <typename Record>
+inline size_t readTraceRecords(std::istream& in, Record* buf, size_t max) {
+    in.read(reinterpret_cast<char*>(buf), max * sizeof(Record));
+    return static_cast<size_t>(in.gcount()) / sizeof(Record);
+}
+
+#endif // TRACEIO_H
@@ -1,25 +1,45 @@
 #include "Predictor.h"
+#include "traceio.h"
 #include <stdlib.h>
 #include <iostream>
 #include<fstream>
 #include<sstream>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <ctype.h>
 #include <math.h>
+#include <stdio.h>
+#include "checkpoint.h"
+#include "profile.h"
 
 using namespace std;
 
 Predictor::Predictor(string ifilename, string ofilename) {
 	this->num_branches = 0; // Initialize the number of branches
+	this->num_taken = 0;
+	this->num_not_taken = 0;
+	this->start = 0;
+	this->silent = false;
+	this->restored_branches = 0;
+	this->valid = true;
 	
 	// Temporary variables
 	unsigned long long addr;
 	string behavior, line;
 	unsigned long long target;
+	PROFILE_SCOPE("parse");
   	
-  	ifstream infile(ifilename); // Open input file
+  	ifstream infile(ifilename, ios::binary); // Open input file
   	this->ofile.open(ofilename); // Open output file
   	
+  	// Binary traces from tracegen are read in blocks of records instead of lines
+  	if(isBinaryTrace(infile)) {
+  		readBinary(infile);
+  		setWindow(0, this->entries.size());
+  		return;
+  	}
+  	
 	// Read lines from the input file
   	while(getline(infile, line)) {
   		this->num_branches++;
@@ -41,34 +61,82 @@ Predictor::Predictor(string ifilename, string ofilename) {
   		
   		this->entries.push_back(e);
   	}
+  	PROFILE_COUNT("branches_parsed", this->entries.size());
+  	
+  	setWindow(0, this->entries.size());
+}
+
+void Predictor::readBinary(ifstream& infile) {
+	traceHeader header;
+	vector<branchRecord> records(1 << 16);
+	size_t n;
+	
+	if(!readTraceHeader(infile, TRACE_BRANCH, header)) {
+		cerr << "Not a branch trace" << endl;
+		this->valid = false;
+		return;
+	}
+	
+	// The header count is only trusted as far as the rest of the file could hold it
+	streampos pos = infile.tellg();
+	if(pos != streampos(-1)) {
+		infile.seekg(0, ios::end);
+		streampos end = infile.tellg();
+		infile.seekg(pos);
+		this->entries.reserve(min((unsigned long long)header.count, (unsigned long long)(end - pos) / sizeof(branchRecord)));
+	}
+	while((n = readTraceRecords(infile, records.data(), records.size())) > 0) {
+		for(size_t i = 0; i < n; i++) {
+			entry e;
+			unpackBranch(records[i], e.address, e.taken, e.target);
+			
+			this->num_branches++;
+			if(e.taken) this->num_taken++;
+			else this->num_not_taken++;
+			
+			this->entries.push_back(e);
+		}
+	}
+	PROFILE_COUNT("branches_parsed", this->entries.size());
 }
 
 void Predictor::alwaysTaken() {
-	int num_correct = 0;
+	PROFILE_PHASE("alwaysTaken", this->last - this->first);
+	unsigned long long& num_correct = state("alwaysTaken").correct;
 	
-	for(entry e : entries) {
+	for(entry e : window()) {
 		if(e.taken) num_correct++; // Increment if branch was correctly predicted as taken
 	}
 
+	PROFILE_PHASE_END();
+	if(this->silent) return;
+	PROFILE_SCOPE("output");
 	this->ofile << num_correct << "," << this->num_branches << ";" << endl;
 }
 
 void Predictor::alwaysNotTaken() {
-	int num_correct = 0;
+	PROFILE_PHASE("alwaysNotTaken", this->last - this->first);
+	unsigned long long& num_correct = state("alwaysNotTaken").correct;
 
-	for(entry e : entries) {
+	for(entry e : window()) {
 		if(!e.taken) num_correct++; // Increment if branch was correctly predicted as not taken
 	}
 
+	PROFILE_PHASE_END();
+	if(this->silent) return;
+	PROFILE_SCOPE("output");
 	this->ofile << num_correct << "," << this->num_branches << ";" << endl;
 }
 
 void Predictor::bimodalSingleBit(int table_size) {
-	int num_correct = 0;
-	vector<bool> table(table_size, true);
+	PROFILE_PHASE("bimodalSingleBit", this->last - this->first);
+	predictorState& st = state("bimodalSingleBit" + to_string(table_size));
+	if(st.bits.empty()) st.bits.assign(table_size, true);
+	unsigned long long& num_correct = st.correct;
+	vector<bool>& table = st.bits;
 	
 	// Iterate through all entries
-	for(entry e : entries) {
+	for(entry e : window()) {
 		int key = e.address % table_size;
 		
 		// Check if the prediction matches the actual outcome
@@ -79,15 +147,21 @@ void Predictor::bimodalSingleBit(int table_size) {
 		}
 	}
 	
+	PROFILE_PHASE_END();
+	if(this->silent) return;
+	PROFILE_SCOPE("output");
 	this->ofile << num_correct << "," << this->num_branches << "; ";
 }
 
 void Predictor::bimodalTwoBits(int table_size) {
-	int num_correct = 0;
-	vector<int> table(table_size, 3);
+	PROFILE_PHASE("bimodalTwoBits", this->last - this->first);
+	predictorState& st = state("bimodalTwoBits" + to_string(table_size));
+	if(st.table.empty()) st.table.assign(table_size, 3);
+	unsigned long long& num_correct = st.correct;
+	vector<int>& table = st.table;
 	
 	// Iterate through all entries
-	for(entry e : entries) {
+	for(entry e : window()) {
 		int key = e.address % table_size; // Calculate the index into the table based on the address modulo the table size
 		
 		if(e.taken && table[key] > 1) { // If the branch is taken and the counter is strongly taken or weakly taken, increment the number of correct predictions and saturate counter to 3 (strongly taken)
@@ -106,17 +180,23 @@ void Predictor::bimodalTwoBits(int table_size) {
 		}
 	}
 	
+	PROFILE_PHASE_END();
+	if(this->silent) return;
+	PROFILE_SCOPE("output");
 	this->ofile << num_correct << "," << this->num_branches << "; ";
 }
 
 void Predictor::gShare(int ghr_size) {
-	int num_correct = 0;
-	int ghr = 0 << ghr_size;
+	PROFILE_PHASE("gShare", this->last - this->first);
+	predictorState& st = state("gShare" + to_string(ghr_size));
+	if(st.table.empty()) st.table.assign(2048, 3);
+	unsigned long long& num_correct = st.correct;
+	int& ghr = st.ghr;
 	int size = pow(2, ghr_size) - 1;
-	vector<int> table(2048, 3);
+	vector<int>& table = st.table;
 
 	// Iterate through all entries
-	for(entry e : entries) {
+	for(entry e : window()) {
 		int key = (e.address ^ (ghr&size)) % 2048;
 		
 		// Check the conditions based on the prediction outcome and the current state of the counter
@@ -142,20 +222,30 @@ void Predictor::gShare(int ghr_size) {
 		}
 	}
 	
+	PROFILE_PHASE_END();
+	if(this->silent) return;
+	PROFILE_SCOPE("output");
 	this->ofile << num_correct << "," << this->num_branches << "; ";
 }
 
 void Predictor::tournament() {
-	int num_correct = 0;
-	int ghr = 0;
+	PROFILE_PHASE("tournament", this->last - this->first);
+	predictorState& st = state("tournament");
+	if(st.table.empty()) {
+		st.selector.assign(2048, 0);
+		st.gshare.assign(2048, 3);
+		st.table.assign(2048, 3);
+	}
+	unsigned long long& num_correct = st.correct;
+	int& ghr = st.ghr;
 	int size = pow(2, 11) - 1;
 
-	vector<int> selector_table(2048, 0);
-	vector<int> gshare_table(2048, 3);
-	vector<int> bimodal_table(2048, 3);
+	vector<int>& selector_table = st.selector;
+	vector<int>& gshare_table = st.gshare;
+	vector<int>& bimodal_table = st.table;
 	
 	// Tournament logic
-	for(entry e : entries) {
+	for(entry e : window()) {
 		int key = e.address % 2048;
 		int gkey = (e.address ^ (ghr&size)) % 2048;
 		
@@ -224,18 +314,27 @@ void Predictor::tournament() {
 		}
 	}
 	
+	PROFILE_PHASE_END();
+	if(this->silent) return;
+	PROFILE_SCOPE("output");
 	this->ofile << num_correct << "," << this->num_branches << "; " << endl;
 }
 
 void Predictor::branchTargetBuffer() {
-	int num_correct = 0;
-	int count = 0;
+	PROFILE_PHASE("branchTargetBuffer", this->last - this->first);
+	predictorState& st = state("branchTargetBuffer");
+	if(st.bits.empty()) {
+		st.bits.assign(512, true);
+		st.btb.resize(128);
+	}
+	unsigned long long& num_correct = st.correct;
+	unsigned long long& count = st.count;
 
-	vector<bool> predictions(512, true);
-	vector<pair<unsigned long long, unsigned long long>> btb(128);
+	vector<bool>& predictions = st.bits;
+	vector<pair<unsigned long long, unsigned long long>>& btb = st.btb;
 	
 	// Iterate through all entries
-	for(entry e : entries) {
+	for(entry e : window()) {
 		int key = e.address % 512;
 		int btb_index = e.address % 128;
 		
@@ -256,6 +355,9 @@ void Predictor::branchTargetBuffer() {
 		predictions[key] = e.taken; // Update the prediction in the predictions vector based on the actual outcome of the branch
 	}
 
+	PROFILE_PHASE_END();
+	if(this->silent) return;
+	PROFILE_SCOPE("output");
 	this->ofile << count << "," << num_correct << ";" << endl;
 	this->ofile.close();
 }
@@ -264,6 +366,154 @@ void Predictor::branchTargetBuffer() {
 // 	for(entry e : entries) cout << "taken?: " << e.taken << " " << "address: " << e.address << endl; // Output whether the branch was taken and its address
 // }
 
+// Returns the state of a predictor configuration, created empty on first use
+predictorState& Predictor::state(string name) {
+	return this->states[name];
+}
+
+entryRange Predictor::window() const {
+	entryRange r;
+	r.first = this->entries.data() + this->first;
+	r.last = this->entries.data() + this->last;
+	return r;
+}
+
+// Makes the next predictor calls simulate entries [first, last) of the trace
+void Predictor::setWindow(size_t first, size_t last) {
+	this->first = first;
+	this->last = last;
+}
+
+void Predictor::setSilent(bool silent) {
+	this->silent = silent;
+}
+
+size_t Predictor::size() const {
+	return this->entries.size();
+}
+
+bool Predictor::isValid() const {
+	return this->valid;
+}
+
+// First entry of the trace still to be simulated after a restore
+size_t Predictor::position() const {
+	return this->start;
+}
+
+const char PREDICTOR_MAGIC[4] = {'B', 'P', 'C', 'K'};
+
+// Saves every predictor table, history and count, up to the end of the current window
+bool Predictor::checkpoint(string filename) {
+	PROFILE_SCOPE("checkpoint");
+	return writeCheckpointFile(filename, PREDICTOR_MAGIC, [this](ostream& out) { save(out); });
+}
+
+void Predictor::save(ostream& out) const {
+	writeValue(out, (uint64_t)(this->restored_branches + this->last - this->start)); // Branches simulated so far
+	writeValue(out, (uint64_t)this->last); // Position in this trace, for resuming
+	writeValue(out, (uint32_t)this->states.size());
+	
+	for(auto& it : this->states) {
+		const predictorState& st = it.second;
+		writeString(out, it.first);
+		writeVector<uint8_t>(out, st.bits);
+		writeVector<uint8_t>(out, st.table); // Counters and selectors never leave 0-3
+		writeVector<uint8_t>(out, st.gshare);
+		writeVector<uint8_t>(out, st.selector);
+		writeValue(out, (uint64_t)st.btb.size());
+		for(auto& b : st.btb) {
+			writeValue(out, b.first);
+			writeValue(out, b.second);
+		}
+		writeValue(out, (int32_t)st.ghr);
+		writeValue(out, (uint64_t)st.correct);
+		writeValue(out, (uint64_t)st.count);
+	}
+}
+
+// Number ending a configuration name such as "bimodalTwoBits512", 0 if the name is not kind followed by one
+static size_t nameSize(const string& name, const string& kind) {
+	if(name.compare(0, kind.size(), kind) != 0 || name.size() == kind.size() || !isdigit(name[kind.size()])) return 0;
+	
+	char* end;
+	unsigned long n = strtoul(name.c_str() + kind.size(), &end, 10);
+	return *end == '\0' ? n : 0;
+}
+
+// True if a restored state has the tables its configuration indexes, with counters in 0-3.
+// The predictors only build a table when it is empty, so a damaged size would be indexed out of bounds.
+static bool hasConfigTables(const string& name, const predictorState& st) {
+	size_t bits = 0, table = 0, gshare = 0, selector = 0, btb = 0, n;
+	
+	if((n = nameSize(name, "bimodalSingleBit")) > 0) bits = n;
+	else if((n = nameSize(name, "bimodalTwoBits")) > 0) table = n;
+	else if(nameSize(name, "gShare") > 0) table = 2048;
+	else if(name == "tournament") table = gshare = selector = 2048;
+	else if(name == "branchTargetBuffer") {
+		bits = 512;
+		btb = 128;
+	}
+	else if(name != "alwaysTaken" && name != "alwaysNotTaken") return false;
+	
+	if(st.bits.size() != bits || st.table.size() != table || st.gshare.size() != gshare || st.selector.size() != selector || st.btb.size() != btb) return false;
+	for(int v : st.table) if(v > 3) return false;
+	for(int v : st.gshare) if(v > 3) return false;
+	for(int v : st.selector) if(v > 3) return false;
+	return true;
+}
+
+// Loads a checkpoint. The trace is then either the next increment after the checkpointed one,
+// or with resume the same trace, continuing after the entries the checkpoint already covers.
+bool Predictor::restore(string filename, bool resume) {
+	PROFILE_SCOPE("checkpoint");
+	ifstream in(filename, ios::binary);
+	uint64_t branches = 0;
+	uint64_t position = 0;
+	uint32_t n = 0;
+	
+	if(!readCheckpointHeader(in, PREDICTOR_MAGIC)) return false;
+	readValue(in, branches);
+	readValue(in, position);
+	readValue(in, n);
+	
+	this->states.clear();
+	for(uint32_t i = 0; i < n && in; i++) {
+		string name;
+		readString(in, name);
+		predictorState& st = this->states[name];
+		readVector<uint8_t>(in, st.bits);
+		readVector<uint8_t>(in, st.table);
+		readVector<uint8_t>(in, st.gshare);
+		readVector<uint8_t>(in, st.selector);
+		
+		uint64_t btb_size = 0;
+		readValue(in, btb_size);
+		if(!in || btb_size > UINT64_MAX / 16 || !checkRemaining(in, btb_size * 16)) break; // Address and target of each entry
+		st.btb.resize(btb_size);
+		for(auto& b : st.btb) {
+			readValue(in, b.first);
+			readValue(in, b.second);
+		}
+		
+		int32_t ghr = 0;
+		readValue(in, ghr);
+		st.ghr = ghr;
+		readValue(in, st.correct);
+		readValue(in, st.count);
+		
+		if(in && !hasConfigTables(name, st)) in.setstate(ios::failbit);
+	}
+	if(!in || (resume && position > this->entries.size())) return false;
+	
+	this->start = resume ? position : 0;
+	this->restored_branches = branches;
+	this->num_branches += branches - this->start; // Entries before start are already counted in the checkpoint
+	setWindow(this->start, this->entries.size());
+	return true;
+}
+
 void Predictor::output(string s) {
-	this->ofile << s;
+	PROFILE_SCOPE("output");
+	if(!this->silent) this->ofile << s;
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <map>
 
 using namespace std;
 struct entry {
@@ -13,6 +14,26 @@ struct entry {
 	unsigned long long target;
 };
 
+// Tables, history and results of one predictor configuration, kept between windows and traces
+struct predictorState {
+	vector<bool> bits;
+	vector<int> table;
+	vector<int> gshare;
+	vector<int> selector;
+	vector<pair<unsigned long long, unsigned long long>> btb;
+	int ghr = 0;
+	unsigned long long correct = 0;
+	unsigned long long count = 0;
+};
+
+// Entries simulated by the next predictor calls
+struct entryRange {
+	const entry* first;
+	const entry* last;
+	const entry* begin() const { return first; }
+	const entry* end() const { return last; }
+};
+
 class Predictor {
 	public:
 		Predictor(string, string);
@@ -25,13 +46,33 @@ class Predictor {
 		void branchTargetBuffer();
 		//void getEntries();
 		void output(string);
+		void setWindow(size_t first, size_t last);
+		void setSilent(bool silent);
+		size_t size() const;
+		size_t position() const;
+		bool isValid() const;
+		bool checkpoint(string filename);
+		bool restore(string filename, bool resume);
 	
 	private:
+		void readBinary(ifstream& infile);
+		void save(ostream& out) const;
+		predictorState& state(string name);
+		entryRange window() const;
+		
+		map<string, predictorState> states;
+		size_t first; // Window of entries the predictors run over
+		size_t last;
+		size_t start; // First entry of this trace not already in a restored checkpoint
+		bool silent; // No output while simulating windows between checkpoints
+		unsigned long long restored_branches; // Branches of earlier runs in a restored checkpoint
+		bool valid; // False if the trace could not be read
+
 		vector<entry> entries;
 		ofstream ofile;
-		int num_taken;
-		int num_not_taken;
-		int num_branches;
+		unsigned long long num_taken;
+		unsigned long long num_not_taken;
+		unsigned long long num_branches;
 };
 
 #endif
\ No newline at end of file
@@ -1,14 +1,15 @@
 #include <iostream>
 #include <stdlib.h>
+#include <string>
 #include "Predictor.h"
+#include "profile.h"
 
-int main(int argc, char* argv[]) {
-	Predictor p = Predictor(argv[1], argv[2]);
-
+// Runs every predictor configuration over the current window and outputs the results
+void runAll(Predictor& p) {
 	p.alwaysTaken();
-	
+
 	p.alwaysNotTaken();
-	
+
 	p.bimodalSingleBit(16);
 	p.bimodalSingleBit(32);
 	p.bimodalSingleBit(128);
@@ -26,7 +27,7 @@ int main(int argc, char* argv[]) {
 	p.bimodalTwoBits(1024);
 	p.bimodalTwoBits(2048);
 	p.output("\n");
-	
+
 	p.gShare(3);
 	p.gShare(4);
 	p.gShare(5);
@@ -37,8 +38,74 @@ int main(int argc, char* argv[]) {
 	p.gShare(10);
 	p.gShare(11);
 	p.output("\n");
-	
+
 	p.tournament();
-	
+
 	p.branchTargetBuffer();
-}
\ No newline at end of file
+}
+
+void usage(const char* name) {
+	cerr << "Usage: " << name << " <trace> <output> [options]" << endl
+	     << "  --restore file     start from a checkpoint, the trace being the next increment" << endl
+	     << "  --resume file      start from a checkpoint of this same trace, skipping what it covers" << endl
+	     << "  --checkpoint file  save the predictor state at the end, and every --every branches" << endl
+	     << "  --every n          branches between checkpoints (default 0, only at the end)" << endl;
+}
+
+int main(int argc, char* argv[]) {
+	string restore_file, checkpoint_file;
+	bool resume = false;
+	size_t every = 0;
+
+	if(argc < 3) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	for(int i = 3; i < argc; i++) {
+		string arg = argv[i];
+		if(i + 1 >= argc) {
+			usage(argv[0]);
+			return 1;
+		}
+		if(arg == "--restore" || arg == "--resume") {
+			restore_file = argv[++i];
+			resume = arg == "--resume";
+		}
+		else if(arg == "--checkpoint") checkpoint_file = argv[++i];
+		else if(arg == "--every") every = strtoull(argv[++i], NULL, 0);
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	Predictor p = Predictor(argv[1], argv[2]);
+	if(!p.isValid()) return 1;
+
+	if(!restore_file.empty() && !p.restore(restore_file, resume)) {
+		cerr << "Could not restore " << restore_file << endl;
+		return 1;
+	}
+
+	// Simulate window by window, saving a checkpoint after each, then output the totals
+	if(every > 0 && !checkpoint_file.empty()) {
+		p.setSilent(true);
+		for(size_t i = p.position(); i < p.size(); i += every) {
+			p.setWindow(i, min(i + every, p.size()));
+			runAll(p);
+			p.checkpoint(checkpoint_file);
+		}
+		p.setSilent(false);
+		p.setWindow(p.size(), p.size());
+	}
+
+	runAll(p);
+
+	if(!checkpoint_file.empty() && !p.checkpoint(checkpoint_file)) {
+		cerr << "Could not write " << checkpoint_file << endl;
+		return 1;
+	}
+	
+	PROFILE_REPORT();
+}
@@ -0,0 +1,164 @@
+#include <vector>
+#include "assist.h"
+#include "checkpoint.h"
+#include "profile.h"
+
+using namespace std;
+
+AssistCache::AssistCache(assistKind kind, int entries) {
+    this->kind = kind;
+    this->entries = entries;
+    this->lines.assign(entries, 0);
+    this->valid.assign(entries, false);
+    this->prev.resize(entries);
+    this->next.resize(entries);
+
+    // Chain every entry into the LRU list, all of them still invalid
+    for (int i = 0; i < entries; i++) {
+        this->prev[i] = i - 1;
+        this->next[i] = i + 1 < entries ? i + 1 : -1;
+    }
+    this->head = entries > 0 ? 0 : -1;
+    this->tail = entries - 1;
+
+    // At least four buckets per entry keeps the probe sequences short
+    this->hashBits = 3;
+    while ((1 << this->hashBits) < entries * 4) this->hashBits++;
+    this->hash.assign(1 << this->hashBits, 0);
+}
+
+// Bucket a line hashes to (Fibonacci hashing)
+int AssistCache::home(unsigned long long line) const {
+    return (line * 0x9e3779b97f4a7c15ULL) >> (64 - this->hashBits);
+}
+
+// Returns the entry holding a line, -1 if there is none
+int AssistCache::find(unsigned long long line) const {
+    int mask = (1 << this->hashBits) - 1;
+    int start = home(line);
+    int i = start;
+    while (this->hash[i] != 0 && this->lines[this->hash[i] - 1] != line) i = (i + 1) & mask;
+
+    PROFILE_COUNT("assist_lookups", 1);
+    PROFILE_COUNT("assist_probes", ((i - start) & mask) + (this->hash[i] != 0)); // Occupied buckets looked at
+    return this->hash[i] != 0 ? this->hash[i] - 1 : -1;
+}
+
+void AssistCache::hashInsert(int slot) {
+    int mask = (1 << this->hashBits) - 1;
+    int i = home(this->lines[slot]);
+    while (this->hash[i] != 0) i = (i + 1) & mask;
+    this->hash[i] = slot + 1;
+}
+
+// Removes a line from the hash, shifting later entries of the probe sequence back so no tombstones are needed
+void AssistCache::hashErase(unsigned long long line) {
+    int mask = (1 << this->hashBits) - 1;
+    int i = home(line);
+    while (this->hash[i] != 0 && this->lines[this->hash[i] - 1] != line) i = (i + 1) & mask;
+    if (this->hash[i] == 0) return;
+
+    this->hash[i] = 0;
+    for (int j = (i + 1) & mask; this->hash[j] != 0; j = (j + 1) & mask) {
+        int k = home(this->lines[this->hash[j] - 1]);
+
+        // Move the bucket back unless its home lies cyclically in (i, j]
+        bool stays = i <= j ? (k > i && k <= j) : (k > i || k <= j);
+        if (!stays) {
+            this->hash[i] = this->hash[j];
+            this->hash[j] = 0;
+            i = j;
+        }
+    }
+}
+
+void AssistCache::unlink(int slot) {
+    if (this->prev[slot] >= 0) this->next[this->prev[slot]] = this->next[slot];
+    else this->head = this->next[slot];
+    if (this->next[slot] >= 0) this->prev[this->next[slot]] = this->prev[slot];
+    else this->tail = this->prev[slot];
+}
+
+void AssistCache::pushFront(int slot) {
+    this->prev[slot] = -1;
+    this->next[slot] = this->head;
+    if (this->head >= 0) this->prev[this->head] = slot;
+    this->head = slot;
+    if (this->tail < 0) this->tail = slot;
+}
+
+// Returns true if the line is held, making it the most recently used entry
+bool AssistCache::lookup(unsigned long long line) {
+    int slot = find(line);
+    if (slot < 0) return false;
+
+    unlink(slot);
+    pushFront(slot);
+    return true;
+}
+
+// Adds a line in place of the least recently used entry
+void AssistCache::insert(unsigned long long line) {
+    if (this->entries == 0 || lookup(line)) return;
+
+    int slot = this->tail;
+    if (this->valid[slot]) hashErase(this->lines[slot]);
+
+    this->lines[slot] = line;
+    this->valid[slot] = true;
+    hashInsert(slot);
+    unlink(slot);
+    pushFront(slot);
+}
+
+// Drops a line, its entry becomes the next one to be replaced
+void AssistCache::remove(unsigned long long line) {
+    int slot = find(line);
+    if (slot < 0) return;
+
+    hashErase(line);
+    this->valid[slot] = false;
+    unlink(slot);
+
+    // Append at the tail
+    this->prev[slot] = this->tail;
+    this->next[slot] = -1;
+    if (this->tail >= 0) this->next[this->tail] = slot;
+    this->tail = slot;
+    if (this->head < 0) this->head = slot;
+}
+
+// Saves the held lines from least to most recently used, so inserting them in order rebuilds the LRU list
+void AssistCache::save(ostream& out) const {
+    vector<unsigned long long> held;
+    for (int slot = this->tail; slot >= 0; slot = this->prev[slot]) {
+        if (this->valid[slot]) held.push_back(this->lines[slot]);
+    }
+
+    writeValue(out, (int32_t)this->kind);
+    writeValue(out, (int32_t)this->entries);
+    writeValue(out, this->hits);
+    writeValue(out, this->swaps);
+    writeVector<uint64_t>(out, held);
+}
+
+void AssistCache::load(istream& in) {
+    int32_t kind = 0, entries = 0;
+    unsigned long long hits = 0, swaps = 0;
+    vector<unsigned long long> held;
+
+    readValue(in, kind);
+    readValue(in, entries);
+    readValue(in, hits);
+    readValue(in, swaps);
+    readVector<uint64_t>(in, held);
+    if (kind != this->kind || entries != this->entries || held.size() > (size_t)entries) {
+        in.setstate(ios::failbit); // Checkpoint of a different configuration
+        return;
+    }
+
+    *this = AssistCache(this->kind, this->entries);
+    for (size_t i = 0; i < held.size(); i++) insert(held[i]);
+    this->hits = hits;
+    this->swaps = swaps;
+}
@@ -0,0 +1,50 @@
+#ifndef ASSIST_CACHE_H
+#define ASSIST_CACHE_H
+
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+enum assistKind {
+    ASSIST_VICTIM, // Holds lines evicted from the cache, swapped back in on a hit
+    ASSIST_MISS    // Holds copies of the lines the cache most recently missed on
+};
+
+// Small fully associative buffer beside a cache, as in Jouppi's victim and
+// miss caches. Lines are found through a compact open addressing hash so
+// a lookup costs the same as a CAM search no matter how many entries there
+// are, and replacement is LRU through a linked list of the entries.
+class AssistCache {
+    public:
+        AssistCache(assistKind kind, int entries);
+        bool lookup(unsigned long long line);
+        void insert(unsigned long long line);
+        void remove(unsigned long long line);
+        void save(ostream& out) const;
+        void load(istream& in);
+
+        assistKind kind;
+        int entries;
+        unsigned long long hits = 0;  // Cache misses caught by this buffer
+        unsigned long long swaps = 0; // Victim cache hits that swapped a line back into the cache
+
+    private:
+        int find(unsigned long long line) const;
+        int home(unsigned long long line) const;
+        void unlink(int slot);
+        void pushFront(int slot);
+        void hashInsert(int slot);
+        void hashErase(unsigned long long line);
+
+        vector<unsigned long long> lines; // Line address held by each entry
+        vector<bool> valid;
+        vector<int> prev;                 // LRU list, head is the most recently used entry
+        vector<int> next;
+        int head;
+        int tail;
+        int hashBits;
+        vector<int> hash;                 // Entry index + 1 for each bucket, 0 when empty
+};
+
+#endif // ASSIST_CACHE_H
@@ -1,7 +1,12 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <iomanip>
+#include <math.h>
+#include <algorithm>
 #include "cache.h"
+#include "checkpoint.h"
+#include "profile.h"
 
 using namespace std;
 
@@ -15,400 +20,608 @@ int log2(int base) {
     return count;
 }
 
-// Simulates a direct mapped cache
-void directMapped(ofstream& fout, vector<trace> traces) {
-    // Array of cache sizes to simulate with
-    const int CACHE_SIZES[4] = {1024, 4096, 16384, 32768};
-    const int LINE_SIZE = 32; // Line size of cache
+// Same as above for sizes that do not fit in an int
+int log2(unsigned long long base) {
+    int count = 0;
+    while (base > 1) {
+        base /= 2;
+        count++;
+    }
+    return count;
+}
 
-    // Loop through each cache size to simulate
-    for (int i = 0; i < sizeof(CACHE_SIZES) / sizeof(CACHE_SIZES[0]); i++) {
-        // Create cache table for current size
-        cache table[CACHE_SIZES[i] / LINE_SIZE];
-        int count = 0; // Count for cache hits
+LruCache::LruCache(unsigned long long cacheSize, unsigned long long lineSize, int ways, bool writeAllocate, prefetchPolicy prefetch) {
+    this->cacheSize = cacheSize;
+    this->lineSize = lineSize;
+    this->ways = ways;
+    this->sets = cacheSize / (lineSize * ways);
+    this->lineShift = log2(lineSize);
+    this->setShift = log2((unsigned long long)this->sets);
+    this->writeAllocate = writeAllocate;
+    this->prefetch = prefetch;
+    this->clock = 0;
+    this->table.resize(this->sets * ways);
+    this->lru.assign(this->sets * ways, -1);
+    this->sampledSets = 0;
+    this->sampledAccesses = 0;
+}
 
-        // Iterate over each trace
-        for (int j = 0; j < traces.size(); j++) {
-            // Calculate index based on address
-            int index = (traces[j].address >> log2(LINE_SIZE)) & ((1 << log2(CACHE_SIZES[i] / LINE_SIZE)) - 1);
+// Odd multiplier scrambling set indices, so the sampled sets do not line up with power of two strides
+const unsigned long long SAMPLE_MULTIPLIER = 0x9e3779b97f4a7c15ULL;
 
-            // Check if cache hit or miss
-            if (table[index].isValid && table[index].tag == traces[j].address >> log2(CACHE_SIZES[i])) count++;
-            else {
-                // Update cache line on miss
-                table[index].isValid = true;
-                table[index].tag = traces[j].address >> log2(CACHE_SIZES[i]);
-            }
+// Simulates only one in ratio sets. Set indices are scrambled by an odd multiplier, which is a
+// bijection modulo the number of sets, and the sets landing below sets / ratio are sampled. The
+// scrambled index is then also the row of the set in the shrunken tables, so no lookup table is needed.
+// At least two sets are kept, the fewest the confidence interval can be estimated from.
+// Must be called before the first access.
+void LruCache::sample(int ratio) {
+    this->sampledSets = min(this->sets, max(2, this->sets / ratio));
+
+    vector<cache>(this->sampledSets * this->ways).swap(this->table);
+    vector<long long>(this->sampledSets * this->ways, -1).swap(this->lru);
+    this->setHits.assign(this->sampledSets, 0);
+    this->setAccesses.assign(this->sampledSets, 0);
+}
+
+// Row of the table holding the set of a line, -1 if that set is not sampled
+int LruCache::row(unsigned long long line) const {
+    unsigned long long index = line & ((1ULL << this->setShift) - 1);
+    if (this->sampledSets == 0) return index;
+
+    unsigned long long r = (index * SAMPLE_MULTIPLIER) & ((1ULL << this->setShift) - 1);
+    return r < (unsigned long long)this->sampledSets ? (int)r : -1;
+}
+
+// Ratio estimate of the hit rate over the sampled sets, with the half width of its 95% confidence interval
+void LruCache::estimate(double& rate, double& error) const {
+    size_t n = this->setHits.size();
+    unsigned long long simulated = this->simulated();
+
+    rate = simulated ? (double)this->hits / simulated : 0.0;
+    error = 0.0;
+    if (!isSampled() || n < 2 || simulated == 0) return;
+
+    // Variance of the per-set residuals h - rate * a, with the finite population correction for sampling n of the sets
+    double residuals = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double d = this->setHits[i] - rate * this->setAccesses[i];
+        residuals += d * d;
+    }
+    double meanAccesses = (double)simulated / n;
+    double variance = residuals / (n - 1) * (1.0 - (double)n / this->sets) / n;
+    error = 1.96 * sqrt(variance) / meanAccesses;
+}
+
+// Looks up a line (address >> lineShift) and refreshes its LRU time on a hit
+bool LruCache::touch(unsigned long long line) {
+    int r = row(line);
+    if (r < 0) return false;
+
+    unsigned long long tag = line >> this->setShift;
+    cache* set = &this->table[r * this->ways];
+
+    // Search for the line in the set
+    PROFILE_COUNT("lru_lookups", 1);
+    for (int k = 0; k < this->ways; k++) {
+        if (set[k].isValid && set[k].tag == tag) {
+            this->lru[r * this->ways + k] = this->clock++; // Update LRU
+            PROFILE_COUNT("lru_lookup_ways", k + 1);
+            return true;
         }
-        
-        // Output the hit rate for the current cache size
-        fout << count << ',' << traces.size() << "; ";
-    }
-    
-    fout << endl;
-}
-
-// Simulates a set associative cache
-void setAssociative(ofstream& fout, vector<trace> traces) {
-    const int CACHE_SIZE = 16384; // Total size of cache
-    const int LINE_SIZE = 32;     // Size of each line/block in the cache
-
-    // Iterate through different set sizes
-    for (int i = 2; i <= 16; i *= 2) {
-        // Create a 2D array for cache simulation: rows for sets, columns for ways
-        cache table[CACHE_SIZE / (LINE_SIZE * i)][i];
-        int count = 0; // Cache hits counter
-        int lru[CACHE_SIZE / (LINE_SIZE * i)][i]; // LRU tracking array
-        
-        // Initialize LRU information
-        for (int j = 0; j < CACHE_SIZE / (LINE_SIZE * i); j++) {
-            for (int k = 0; k < i; k++) lru[j][k] = -1;
+    }
+    PROFILE_COUNT("lru_lookup_ways", this->ways);
+    return false;
+}
+
+// Puts a line in place of the least recently used line of its set, returns true if a valid line was evicted
+bool LruCache::fill(unsigned long long line, unsigned long long& evicted) {
+    int index = line & ((1ULL << this->setShift) - 1);
+    int r = row(line);
+    if (r < 0) return false; // Set is not sampled
+
+    long long* times = &this->lru[r * this->ways];
+    cache* set = &this->table[r * this->ways];
+    int lruIndex = 0; // LRU index
+
+    // Find the least recently used line
+    PROFILE_COUNT("lru_victim_searches", 1);
+    PROFILE_COUNT("lru_victim_ways", this->ways);
+    for (int k = 1; k < this->ways; k++) {
+        if (times[k] < times[lruIndex]) lruIndex = k;
+    }
+
+    bool isEvicted = set[lruIndex].isValid;
+    evicted = (set[lruIndex].tag << this->setShift) | index;
+
+    // Update the LRU line with the new line
+    set[lruIndex].isValid = true;
+    set[lruIndex].tag = line >> this->setShift;
+    times[lruIndex] = this->clock++; // Update LRU index
+    return isEvicted;
+}
+
+// Brings a line into the cache, handing the evicted line to the victim cache if there is one
+void LruCache::allocate(unsigned long long line) {
+    unsigned long long evicted;
+    bool isEvicted = fill(line, evicted);
+
+    if (this->assist && this->assist->kind == ASSIST_VICTIM) {
+        this->assist->remove(line); // A line is never in both the cache and its victim cache
+        if (isEvicted) this->assist->insert(evicted);
+    }
+}
+
+// Attaches a small fully associative victim or miss cache of the given number of lines
+void LruCache::attach(assistKind kind, int entries) {
+    this->assist.reset(new AssistCache(kind, entries));
+}
+
+bool LruCache::access(const trace& t) {
+    unsigned long long line = t.address >> this->lineShift;
+    int sampledRow = -1;
+
+    this->accesses++;
+
+    // Drop accesses to sets that are not sampled before touching the tables
+    if (this->sampledSets > 0) {
+        sampledRow = row(line);
+        if (sampledRow < 0) {
+            PROFILE_COUNT("lru_sampled_out", 1);
+            return false;
         }
-        
-        // Process each trace
-        for (int j = 0; j < traces.size(); j++) {
-            bool isFound = false;
-            // Calculate index based on cache formula
-            int index = (traces[j].address >> log2(LINE_SIZE)) & ((1 << log2(CACHE_SIZE / (LINE_SIZE * i))) - 1);
-            
-            // Search for the trace in the set
-            for (int k = 0; !isFound && k < i; k++) {
-                if (table[index][k].isValid && table[index][k].tag == traces[j].address >> log2(CACHE_SIZE / i)) {
-                    isFound = true;
-                    count++; // Increment hit count
-                    lru[index][k] = j; // Update LRU
-                }
-            }
-            
-            // Handle cache miss
-            if (!isFound) {
-                int lruIndex = 0; // LRU index
-                // Find the least recently used line
-                for (int k = 1; k < i; k++) {
-                    if (lru[index][k] < lru[index][lruIndex]) lruIndex = k;
+        this->sampledAccesses++;
+        this->setAccesses[sampledRow]++;
+    }
+
+    bool isFound = touch(line);
+    bool isAllocated = this->writeAllocate || t.type != 'S'; // No allocation on a store miss if disabled
+
+    if (isFound) {
+        this->hits++;
+        if (sampledRow >= 0) this->setHits[sampledRow]++;
+    }
+    else if (this->assist && this->assist->lookup(line)) {
+        // Miss caught by the victim or miss cache, the line still moves into the cache
+        this->assist->hits++;
+        if (isAllocated) {
+            if (this->assist->kind == ASSIST_VICTIM) this->assist->swaps++;
+            allocate(line);
+        }
+    }
+    else if (isAllocated) {
+        if (this->assist && this->assist->kind == ASSIST_MISS) this->assist->insert(line);
+        allocate(line);
+    }
+
+    // Prefetch the next line, refreshing it if it is already cached
+    if (this->prefetch == PREFETCH_ALWAYS || (this->prefetch == PREFETCH_ON_MISS && !isFound)) {
+        if (!touch(line + 1)) allocate(line + 1);
+    }
+    return isFound;
+}
+
+// Saves the configuration, counts and contents. LRU times are stored as each line's rank within its
+// set, which is all replacement depends on, and tags only for valid lines.
+void LruCache::save(ostream& out) const {
+    int rows = this->table.size() / this->ways;
+
+    writeValue(out, (uint64_t)this->cacheSize);
+    writeValue(out, (uint64_t)this->lineSize);
+    writeValue(out, (int32_t)this->ways);
+    writeValue(out, (uint8_t)this->writeAllocate);
+    writeValue(out, (uint8_t)this->prefetch);
+    writeValue(out, (int32_t)this->sampledSets);
+    writeValue(out, this->hits);
+    writeValue(out, this->accesses);
+    writeValue(out, this->sampledAccesses);
+
+    for (int r = 0; r < rows; r++) {
+        const long long* times = &this->lru[r * this->ways];
+        const cache* set = &this->table[r * this->ways];
+
+        for (int k = 0; k < this->ways; k++) {
+            // Rank 0 marks an invalid line, valid lines are ranked from 1 (least recently used)
+            uint16_t rank = 0;
+            if (set[k].isValid) {
+                rank = 1;
+                for (int m = 0; m < this->ways; m++) {
+                    if (set[m].isValid && times[m] < times[k]) rank++;
                 }
-                
-                // Update the LRU line with the new trace
-                table[index][lruIndex].isValid = true;
-                table[index][lruIndex].tag = traces[j].address >> log2(CACHE_SIZE / i);
-                
-                lru[index][lruIndex] = j; // Update LRU index
             }
+            writeValue(out, rank);
+            if (set[k].isValid) writeValue(out, (uint64_t)set[k].tag);
         }
-        
-        // Output the hit rate for the current configuration
-        fout << count << ',' << traces.size() << "; ";
-    }
-    
-    fout << endl;
-}
-
-// Simulates a fully associative cache using LRU replacement policy
-void fullyAssociativeLru(ofstream& fout, vector<trace> traces) {
-    const int CACHE_SIZE = 16384; // Cache size
-    const int LINE_SIZE = 32;     // Line size
-    
-    cache table[CACHE_SIZE / LINE_SIZE]; // Cache table
-    int count = 0; // Hit counter
-    int lru[CACHE_SIZE / LINE_SIZE]; // LRU array
-    
-    // Initialize LRU indices
-    for (int i = 0; i < CACHE_SIZE / LINE_SIZE; i++) lru[i] = -1;
-    
-    // Process each trace
-    for (int i = 0; i < traces.size(); i++) {
-        bool isFound = false;
-        
-        // Search for the trace in the cache
-        for (int j = 0; !isFound && j < CACHE_SIZE / LINE_SIZE; j++) {
-            if (table[j].isValid && table[j].tag == traces[i].address >> log2(LINE_SIZE)) {
-                isFound = true;
-                count++; // Increment hit counter
-                lru[j] = i; // Update LRU
+    }
+
+    writeVector<uint64_t>(out, this->setHits);
+    writeVector<uint64_t>(out, this->setAccesses);
+
+    writeValue(out, (uint8_t)(this->assist ? 1 : 0));
+    if (this->assist) this->assist->save(out);
+}
+
+void LruCache::load(istream& in) {
+    uint64_t cacheSize = 0, lineSize = 0;
+    int32_t ways = 0, sampledSets = 0;
+    uint8_t writeAllocate = 0, prefetch = 0, hasAssist = 0;
+    int rows = this->table.size() / this->ways;
+
+    readValue(in, cacheSize);
+    readValue(in, lineSize);
+    readValue(in, ways);
+    readValue(in, writeAllocate);
+    readValue(in, prefetch);
+    readValue(in, sampledSets);
+    if (cacheSize != this->cacheSize || lineSize != this->lineSize || ways != this->ways || (bool)writeAllocate != this->writeAllocate
+        || prefetch != this->prefetch || sampledSets != this->sampledSets) {
+        in.setstate(ios::failbit);
+        return;
+    }
+
+    readValue(in, this->hits);
+    readValue(in, this->accesses);
+    readValue(in, this->sampledAccesses);
+
+    for (int i = 0; i < rows * this->ways; i++) {
+        uint16_t rank = 0;
+        uint64_t tag = 0;
+
+        readValue(in, rank);
+        if (rank > 0) readValue(in, tag);
+        this->table[i].isValid = rank > 0;
+        this->table[i].tag = tag;
+        this->lru[i] = (long long)rank - 1;
+    }
+    this->clock = this->ways; // Later than every restored rank
+
+    readVector<uint64_t>(in, this->setHits);
+    readVector<uint64_t>(in, this->setAccesses);
+    if (this->setHits.size() != (size_t)sampledSets || this->setAccesses.size() != (size_t)sampledSets) {
+        in.setstate(ios::failbit);
+        return;
+    }
+
+    readValue(in, hasAssist);
+    if ((hasAssist != 0) != (this->assist != NULL)) in.setstate(ios::failbit);
+    else if (this->assist) this->assist->load(in);
+}
+
+HotColdCache::HotColdCache(unsigned long long cacheSize, unsigned long long lineSize) {
+    this->lines = cacheSize / lineSize;
+    this->lineShift = log2(lineSize);
+    this->table.resize(this->lines);
+    this->tree.assign(this->lines - 1, false);
+}
+
+bool HotColdCache::access(const trace& t) {
+    unsigned long long tag = t.address >> this->lineShift;
+    bool isFound = false;
+
+    this->accesses++;
+
+    // Search for the trace in the cache
+    int j = 0;
+    for (; !isFound && j < this->lines; j++) {
+        if (this->table[j].isValid && this->table[j].tag == tag) {
+            isFound = true;
+            this->hits++; // Increment hit counter
+
+            // Update LRU path starting from the corresponding leaf to the root
+            for (int k = j + this->lines - 1; k > 0; k = (k - 1) / 2) {
+                this->tree[(k - 1) / 2] = (k % 2 == 0);
             }
         }
-        
-        // Handle cache miss
-        if (!isFound) {
-            int lruIndex = 0; // LRU index
-            
-            // Find the least recently used line
-            for (int j = 1; j < CACHE_SIZE / LINE_SIZE; j++) {
-                if (lru[j] < lru[lruIndex]) lruIndex = j;
+    }
+
+    PROFILE_COUNT("hotcold_lookups", 1);
+    PROFILE_COUNT("hotcold_lookup_lines", j);
+
+    // Handle cache miss
+    if (!isFound) {
+        j = 0;
+
+        // Traverse the Hot-Cold LRU tree to find the coldest element
+        PROFILE_COUNT("hotcold_victim_searches", 1);
+        while (j < this->lines - 1) {
+            if (!this->tree[j]) {
+                this->tree[j] = true;
+                j = (j * 2) + 2; // Move to the right child
+            }
+            else {
+                this->tree[j] = false;
+                j = (j * 2) + 1; // Move to the left child
             }
-            
-            // Update the LRU line with the new trace
-            table[lruIndex].isValid = true;
-            table[lruIndex].tag = traces[i].address >> log2(LINE_SIZE);
-            
-            lru[lruIndex] = i; // Update LRU index
         }
+
+        // Update the coldest element with the new trace
+        this->table[j - this->lines + 1].isValid = true;
+        this->table[j - this->lines + 1].tag = tag;
     }
-    
-    // Output the hit rate
-    fout << count << ',' << traces.size() << "; " << endl;
-}
-
-// Simulates a fully associative cache using a Hot-Cold replacement policy
-void fullyAssociativeHotCold(ofstream& fout, vector<trace> traces) {
-    const int CACHE_SIZE = 16384; // Cache size
-    const int LINE_SIZE = 32;     // Line size
-    bool lru[(CACHE_SIZE / LINE_SIZE) - 1]; // Array to manage the Hot-Cold LRU status
-    cache table[CACHE_SIZE / LINE_SIZE]; // Cache table
-    int count = 0; // Hit counter
-
-    // Initialize the Hot-Cold LRU array
-    for (int i = 0; i < (CACHE_SIZE / LINE_SIZE) - 1; i++) lru[i] = false;
-
-    // Process each trace
-    for (int i = 0; i < traces.size(); i++) {
-        bool isFound = false;
-        
-        // Search for the trace in the cache
-        for (int j = 0; !isFound && j < (CACHE_SIZE / LINE_SIZE); j++) {
-            if (table[j].isValid && table[j].tag == traces[i].address >> log2(LINE_SIZE)) {
-                isFound = true;
-                count++; // Increment hit counter
-                
-                // Update LRU path starting from the corresponding leaf to the root
-                for (int k = j + (CACHE_SIZE / LINE_SIZE) - 1; k > 0; k = (k - 1) / 2) {
-                    if (k % 2 == 0) lru[(k - 1)/2] = true;
-					else lru[(k - 1)/2] = false;
-                }
+    return isFound;
+}
+
+void HotColdCache::save(ostream& out) const {
+    writeValue(out, (int32_t)this->lines);
+    writeValue(out, (int32_t)this->lineShift);
+    writeValue(out, this->hits);
+    writeValue(out, this->accesses);
+
+    vector<bool> valid(this->lines);
+    vector<unsigned long long> tags(this->lines);
+    for (int i = 0; i < this->lines; i++) {
+        valid[i] = this->table[i].isValid;
+        tags[i] = this->table[i].tag;
+    }
+    writeVector<uint8_t>(out, valid);
+    writeVector<uint64_t>(out, tags);
+    writeVector<uint8_t>(out, this->tree);
+}
+
+void HotColdCache::load(istream& in) {
+    int32_t lines = 0, lineShift = 0;
+    vector<bool> valid, tree;
+    vector<unsigned long long> tags;
+
+    readValue(in, lines);
+    readValue(in, lineShift);
+    if (lines != this->lines || lineShift != this->lineShift) {
+        in.setstate(ios::failbit);
+        return;
+    }
+
+    readValue(in, this->hits);
+    readValue(in, this->accesses);
+    readVector<uint8_t>(in, valid);
+    readVector<uint64_t>(in, tags);
+    readVector<uint8_t>(in, tree);
+    if (!in || valid.size() != (size_t)lines || tags.size() != (size_t)lines || tree.size() != (size_t)lines - 1) {
+        in.setstate(ios::failbit);
+        return;
+    }
+
+    for (int i = 0; i < lines; i++) {
+        this->table[i].isValid = valid[i];
+        this->table[i].tag = tags[i];
+    }
+    this->tree = tree;
+}
+
+// Direct mapped caches of 1KB, 4KB, 16KB and 32KB with 32 byte lines
+cacheGroup directMappedConfigs() {
+    const int CACHE_SIZES[4] = {1024, 4096, 16384, 32768};
+    const int LINE_SIZE = 32;
+    cacheGroup group;
+
+    for (int i = 0; i < 4; i++) group.push_back(unique_ptr<CacheModel>(new LruCache(CACHE_SIZES[i], LINE_SIZE, 1)));
+    return group;
+}
+
+// 16KB caches with 32 byte lines and 2, 4, 8 and 16 ways
+static cacheGroup setAssociativeFamily(bool writeAllocate, prefetchPolicy prefetch) {
+    const int CACHE_SIZE = 16384;
+    const int LINE_SIZE = 32;
+    cacheGroup group;
+
+    for (int i = 2; i <= 16; i *= 2) group.push_back(unique_ptr<CacheModel>(new LruCache(CACHE_SIZE, LINE_SIZE, i, writeAllocate, prefetch)));
+    return group;
+}
+
+cacheGroup setAssociativeConfigs() {
+    return setAssociativeFamily(true, PREFETCH_NONE);
+}
+
+// 16KB fully associative cache with 32 byte lines and LRU replacement
+cacheGroup fullyAssociativeLruConfigs() {
+    cacheGroup group;
+    group.push_back(unique_ptr<CacheModel>(new LruCache(16384, 32, 16384 / 32)));
+    return group;
+}
+
+// 16KB fully associative cache with 32 byte lines and Hot-Cold replacement
+cacheGroup fullyAssociativeHotColdConfigs() {
+    cacheGroup group;
+    group.push_back(unique_ptr<CacheModel>(new HotColdCache(16384, 32)));
+    return group;
+}
+
+cacheGroup setAssociativeNoAllocationWriteMissConfigs() {
+    return setAssociativeFamily(false, PREFETCH_NONE);
+}
+
+cacheGroup setAssociativeNextLinePrefetchingConfigs() {
+    return setAssociativeFamily(true, PREFETCH_ALWAYS);
+}
+
+cacheGroup prefetchMissConfigs() {
+    return setAssociativeFamily(true, PREFETCH_ON_MISS);
+}
+
+// Caches of one size and line size with 1 to 32 ways, each simulating one in sampleRatio sets
+cacheGroup sampledSweepConfigs(unsigned long long cacheSize, unsigned long long lineSize, int sampleRatio) {
+    cacheGroup group;
+
+    for (int i = 1; i <= 32; i *= 2) {
+        LruCache* model = new LruCache(cacheSize, lineSize, i);
+        model->sample(sampleRatio);
+        group.push_back(unique_ptr<CacheModel>(model));
+    }
+    return group;
+}
+
+CacheSuite::CacheSuite(int sampleRatio) {
+    this->assisted = false;
+    this->sampleRatio = sampleRatio;
+
+    if (sampleRatio > 0) {
+        // Sweep of 256KB to 64MB caches with 32, 64 and 128 byte lines
+        for (unsigned long long lineSize = 32; lineSize <= 128; lineSize *= 2) {
+            for (unsigned long long cacheSize = 256 * 1024; cacheSize <= 64 * 1024 * 1024; cacheSize *= 2) {
+                this->names.push_back("sweep_" + to_string(cacheSize) + "_" + to_string(lineSize));
+                this->groups.push_back(sampledSweepConfigs(cacheSize, lineSize, sampleRatio));
             }
         }
-        
-        // Handle cache miss
-        if (!isFound) {
-            int j = 0;
-            
-            // Traverse the Hot-Cold LRU tree to find the coldest element
-            while (j < (CACHE_SIZE / LINE_SIZE) - 1) {
-                if (!lru[j]) {
-                    lru[j] = true;
-                    j = (j * 2) + 2; // Move to the right child
-                } 
-                else {
-                    lru[j] = false;
-                    j = (j * 2) + 1; // Move to the left child
-                }
-            }
-            
-            // Update the coldest element with the new trace
-            table[j - (CACHE_SIZE / LINE_SIZE) + 1].isValid = true;
-			table[j - (CACHE_SIZE / LINE_SIZE) + 1].tag = traces[i].address >> log2(LINE_SIZE);
+    }
+    else {
+        // Same configurations and order as the lines of the batch output
+        this->names.push_back("direct_mapped");
+        this->groups.push_back(directMappedConfigs());
+        this->names.push_back("set_associative");
+        this->groups.push_back(setAssociativeConfigs());
+        this->names.push_back("fully_associative_lru");
+        this->groups.push_back(fullyAssociativeLruConfigs());
+        this->names.push_back("fully_associative_hot_cold");
+        this->groups.push_back(fullyAssociativeHotColdConfigs());
+        this->names.push_back("no_write_allocate");
+        this->groups.push_back(setAssociativeNoAllocationWriteMissConfigs());
+        this->names.push_back("next_line_prefetch");
+        this->groups.push_back(setAssociativeNextLinePrefetchingConfigs());
+        this->names.push_back("prefetch_on_miss");
+        this->groups.push_back(prefetchMissConfigs());
+    }
+
+    for (size_t i = 0; i < this->groups.size(); i++) {
+        for (size_t j = 0; j < this->groups[i].size(); j++) {
+            this->lastHits.push_back(0);
+            this->lastAccesses.push_back(0);
         }
     }
-    
-    // Output the hit rate
-    fout << count << ',' << traces.size() << "; " << endl;
-}
-
-// Wrapper function to simulate both LRU and Hot-Cold fully associative cache behaviors
-void fullyAssociative(ofstream& fout, vector<trace> traces) {
-    fullyAssociativeLru(fout, traces);
-    fullyAssociativeHotCold(fout, traces);
-}
-
-// Simulates set associative cache with no allocation on write miss
-void setAssociativeNoAllocationWriteMiss(ofstream& fout, vector<trace> traces) {
-    const int CACHE_SIZE = 16384; // Cache size
-    const int LINE_SIZE = 32;     // Line size
-    
-    // Iterate through different set sizes
-    for (int i = 2; i <= 16; i *= 2) {
-        cache table[CACHE_SIZE / (LINE_SIZE * i)][i]; // 2D cache table
-        int count = 0; // Hit counter
-        int lru[CACHE_SIZE / (LINE_SIZE * i)][i]; // LRU tracking array
-        
-        // Initialize LRU information
-        for (int j = 0; j < CACHE_SIZE / (LINE_SIZE * i); j++) {
-            for (int k = 0; k < i; k++) lru[j][k] = -1;
+}
+
+// Attaches a victim or miss cache to every LRU configuration
+void CacheSuite::attach(assistKind kind, int entries) {
+    for (size_t i = 0; i < this->groups.size(); i++) {
+        for (size_t j = 0; j < this->groups[i].size(); j++) {
+            LruCache* model = dynamic_cast<LruCache*>(this->groups[i][j].get());
+            if (model) model->attach(kind, entries);
         }
-        
-        // Process each trace
-        for (int j = 0; j < traces.size(); j++) {
-            bool isFound = false;
-            int index = (traces[j].address >> log2(LINE_SIZE)) & ((1 << log2(CACHE_SIZE / (LINE_SIZE * i))) - 1);
-            
-            // Search for the trace in the set
-            for (int k = 0; !isFound && k < i; k++) {
-                if (table[index][k].isValid && table[index][k].tag == traces[j].address >> log2(CACHE_SIZE / i)) {
-                    isFound = true;
-                    count++; // Increment hit counter
-                    lru[index][k] = j; // Update LRU
-                }
-            }
-            
-            // Handle cache miss differently for store ('S') operations
-            if (!isFound && traces[j].type != 'S') {
-                int lruIndex = 0;
-                // Find the least recently used line
-                for (int k = 1; k < i; k++) {
-                    if (lru[index][k] < lru[index][lruIndex]) lruIndex = k;
-                }
-                
-                // Update the LRU line with the new trace if not a store operation
-                table[index][lruIndex].isValid = true;
-                table[index][lruIndex].tag = traces[j].address >> log2(CACHE_SIZE / i);
-                
-                lru[index][lruIndex] = j; // Update LRU index
+    }
+    this->assisted = true;
+}
+
+// Feeds a batch of accesses to every configuration, one configuration at a time so its tables stay in the host cache
+void CacheSuite::access(const vector<trace>& batch) {
+    for (size_t i = 0; i < this->groups.size(); i++) {
+        PROFILE_SCOPE_EVENTS(this->names[i], batch.size() * this->groups[i].size());
+        for (size_t j = 0; j < this->groups[i].size(); j++) {
+            CacheModel* model = this->groups[i][j].get();
+            for (size_t k = 0; k < batch.size(); k++) model->access(batch[k]);
+        }
+    }
+}
+
+// Outputs the hit counts in the same format as the batch simulation. A sweep
+// outputs one configuration per line instead, as
+// "cache size,line size,ways,estimated hits,accesses,hit rate,error;"
+// where error is the half width of the 95% confidence interval of the hit rate.
+void CacheSuite::report(ostream& fout) const {
+    PROFILE_SCOPE("output");
+    if (this->sampleRatio > 0) {
+        for (size_t i = 0; i < this->groups.size(); i++) {
+            for (size_t j = 0; j < this->groups[i].size(); j++) {
+                const LruCache* model = static_cast<const LruCache*>(this->groups[i][j].get());
+                double rate, error;
+
+                model->estimate(rate, error);
+                fout << model->cacheSize << ',' << model->lineSize << ',' << model->associativity() << ','
+                     << (unsigned long long)(rate * model->accesses + 0.5) << ',' << model->accesses << ','
+                     << fixed << setprecision(6) << rate << ',' << error << defaultfloat << ';' << endl;
             }
         }
-        
-        // Output the hit rate for the current configuration
-        fout << count << ',' << traces.size() << "; ";
-    }
-    
-    fout << endl;
-}
-
-// Simulates set associative cache with next-line prefetching
-void setAssociativeNextLinePrefetching(ofstream& fout, vector<trace> traces) {
-    const int CACHE_SIZE = 16384; // Total cache size
-    const int LINE_SIZE = 32;     // Size of each cache line/block
-
-    // Iterate through different set sizes
-    for (int i = 2; i <= 16; i *= 2) {
-        cache table[CACHE_SIZE / (LINE_SIZE * i)][i]; // Cache table with multiple sets and ways
-        int count = 0; // Hit counter
-        int lru[CACHE_SIZE / (LINE_SIZE * i)][i]; // LRU tracking array
-        
-        // Initialize LRU information
-        for (int j = 0; j < CACHE_SIZE / (LINE_SIZE * i); j++) {
-            for (int k = 0; k < i; k++) lru[j][k] = -1;
+        return;
+    }
+
+    for (size_t i = 0; i < this->groups.size(); i++) {
+        for (size_t j = 0; j < this->groups[i].size(); j++) {
+            fout << this->groups[i][j]->hits << ',' << this->groups[i][j]->accesses << "; ";
         }
-        
-        // Process each trace
-        for (int j = 0; j < traces.size(); j++) {
-            bool isFound = false;
-            // Calculate index for current trace
-            int index = (traces[j].address >> log2(LINE_SIZE)) & ((1 << log2(CACHE_SIZE / (LINE_SIZE * i))) - 1);
-            
-            // Search for the current trace in cache
-            for (int k = 0; !isFound && k < i; k++) {
-                if (table[index][k].isValid && table[index][k].tag == traces[j].address >> log2(CACHE_SIZE / i)) {
-                    isFound = true;
-                    count++; // Increment hit counter
-                    lru[index][k] = j * 2; // Update LRU, multiplying by 2 to differentiate from prefetch updates
-                }
-            }
-            
-            // If miss, find the LRU line to replace
-            if (!isFound) {
-                int lruIndex = 0;
-                for (int k = 1; k < i; k++) {
-                    if (lru[index][k] < lru[index][lruIndex]) lruIndex = k;
-                }
-                
-                // Update the cache line
-                table[index][lruIndex].isValid = true;
-                table[index][lruIndex].tag = traces[j].address >> log2(CACHE_SIZE / i);
-                lru[index][lruIndex] = j * 2; // Set LRU
-            }
+        fout << endl;
+    }
 
-            // Prefetch the next line
-            isFound = false;
-            index = ((traces[j].address >> log2(LINE_SIZE)) + 1) & ((1 << log2(CACHE_SIZE / (LINE_SIZE * i))) - 1);
-            for (int k = 0; !isFound && k < i; k++) {
-                if (table[index][k].isValid && table[index][k].tag == (traces[j].address + LINE_SIZE) >> log2(CACHE_SIZE / i)) {
-                    isFound = true;
-                    lru[index][k] = (j * 2) + 1; // Update LRU for prefetch
-                }
-            }
+    // With a victim or miss cache, the same lines again as "hits,accesses,assist hits,swaps"
+    if (!this->assisted) return;
+    for (size_t i = 0; i < this->groups.size(); i++) {
+        for (size_t j = 0; j < this->groups[i].size(); j++) {
+            const LruCache* model = dynamic_cast<const LruCache*>(this->groups[i][j].get());
+            const AssistCache* assist = model ? model->assistCache() : NULL;
 
-            // If the prefetch line is not in the cache, fetch it
-            if (!isFound) {
-                int lruIndex = 0;
-                for (int k = 1; k < i; k++) {
-                    if (lru[index][k] < lru[index][lruIndex]) lruIndex = k;
-                }
+            fout << this->groups[i][j]->hits << ',' << this->groups[i][j]->accesses << ','
+                 << (assist ? assist->hits : 0) << ',' << (assist ? assist->swaps : 0) << "; ";
+        }
+        fout << endl;
+    }
+}
 
-                // Update the cache line with prefetched address
-                table[index][lruIndex].isValid = true;
-                table[index][lruIndex].tag = (traces[j].address + LINE_SIZE) >> log2(CACHE_SIZE / i);
-                lru[index][lruIndex] = (j * 2) + 1; // Set LRU
-            }
+// Outputs one line per group with the hit rates since the previous call (window) and since the start (total)
+void CacheSuite::stats(ostream& out) {
+    PROFILE_SCOPE("output");
+    size_t n = 0;
+    unsigned long long accesses = this->groups[0][0]->accesses;
+
+    out << fixed << setprecision(4);
+    for (size_t i = 0; i < this->groups.size(); i++) {
+        out << "accesses=" << accesses << " " << this->names[i] << " window=";
+
+        for (size_t j = 0; j < this->groups[i].size(); j++, n++) {
+            const CacheModel* model = this->groups[i][j].get();
+            unsigned long long hits = model->hits - this->lastHits[n];
+            unsigned long long count = model->simulated() - this->lastAccesses[n];
+
+            out << (j ? "," : "") << (count ? (double)hits / count : 0.0);
+            this->lastHits[n] = model->hits;
+            this->lastAccesses[n] = model->simulated();
         }
-        
-        // Output the hit rate
-        fout << count << ',' << traces.size() << "; ";
-    }
-    
-    fout << endl;
-}
-
-// Simulates prefetching on miss strategy in a set associative cache
-void prefetchMiss(ofstream& fout, vector<trace> traces) {
-    const int CACHE_SIZE = 16384; // Total cache size
-    const int LINE_SIZE = 32;     // Line size
-
-    // Iterate through different set sizes
-    for (int i = 2; i <= 16; i *= 2) {
-        cache table[CACHE_SIZE / (LINE_SIZE * i)][i]; // Cache table
-        int count = 0; // Hit counter
-        int lru[CACHE_SIZE / (LINE_SIZE * i)][i]; // LRU tracking
-        
-        // Initialize LRU information
-        for (int j = 0; j < CACHE_SIZE / (LINE_SIZE * i); j++) {
-            for (int k = 0; k < i; k++) lru[j][k] = -1;
+
+        out << " total=";
+        for (size_t j = 0; j < this->groups[i].size(); j++) {
+            const CacheModel* model = this->groups[i][j].get();
+            out << (j ? "," : "") << (model->simulated() ? (double)model->hits / model->simulated() : 0.0);
         }
-        
-        // Process each trace
-        for (int j = 0; j < traces.size(); j++) {
-            bool isFound = false;
-            // Calculate index for current trace
-            int index = (traces[j].address >> log2(LINE_SIZE)) & ((1 << log2(CACHE_SIZE / (LINE_SIZE * i))) - 1);
-            
-            // Search for the current trace in cache
-            for (int k = 0; !isFound && k < i; k++) {
-                if (table[index][k].isValid && table[index][k].tag == traces[j].address >> log2(CACHE_SIZE / i)) {
-                    isFound = true;
-                    count++; // Increment hit counter
-                    lru[index][k] = j * 2; // Update LRU, multiplying by 2 for differentiation
-                }
-            }
+        out << endl;
+    }
+    out << defaultfloat;
+}
 
-            // If miss, update and prefetch the next line
-            if (!isFound) {
-                int lruIndex = 0;
-                for (int k = 1; k < i; k++) {
-                    if (lru[index][k] < lru[index][lruIndex]) lruIndex = k;
-                }
+// Saves every configuration in order; load expects a suite built with the same options
+void CacheSuite::save(ostream& out) const {
+    writeValue(out, (int32_t)this->sampleRatio);
+    writeValue(out, (uint32_t)this->groups.size());
+    for (size_t i = 0; i < this->groups.size(); i++) {
+        writeString(out, this->names[i]);
+        writeValue(out, (uint32_t)this->groups[i].size());
+        for (size_t j = 0; j < this->groups[i].size(); j++) this->groups[i][j]->save(out);
+    }
+}
 
-                // Update the cache line with the current trace
-                table[index][lruIndex].isValid = true;
-                table[index][lruIndex].tag = traces[j].address >> log2(CACHE_SIZE / i);
-                lru[index][lruIndex] = j * 2; // Set LRU
-
-                // Calculate index for the next line to prefetch
-                isFound = false;
-                index = ((traces[j].address >> log2(LINE_SIZE)) + 1) & ((1 << log2(CACHE_SIZE / (LINE_SIZE * i))) - 1);
-                for (int k = 0; !isFound && k < i; k++) {
-                    if (table[index][k].isValid && table[index][k].tag == (traces[j].address + LINE_SIZE) >> log2(CACHE_SIZE / i)) {
-                        isFound = true;
-                        lru[index][k] = (j * 2) + 1; // Update LRU
-                    }
-                }
+void CacheSuite::load(istream& in) {
+    int32_t sampleRatio = 0;
+    uint32_t groups = 0;
 
-                // If the prefetch line is not in the cache, fetch it
-                if (!isFound) {
-                    lruIndex = 0;
-                    for (int k = 1; k < i; k++) {
-                        if (lru[index][k] < lru[index][lruIndex]) lruIndex = k;
-                    }
-
-                    // Update the cache line with the prefetched address
-                    table[index][lruIndex].isValid = true;
-                    table[index][lruIndex].tag = (traces[j].address + LINE_SIZE) >> log2(CACHE_SIZE / i);
-                    lru[index][lruIndex] = (j * 2) + 1; // Set LRU
-                }
-            }
+    readValue(in, sampleRatio);
+    readValue(in, groups);
+    if (sampleRatio != this->sampleRatio || groups != this->groups.size()) {
+        in.setstate(ios::failbit);
+        return;
+    }
+
+    for (size_t i = 0; i < this->groups.size() && in; i++) {
+        string name;
+        uint32_t models = 0;
+
+        readString(in, name);
+        readValue(in, models);
+        if (name != this->names[i] || models != this->groups[i].size()) {
+            in.setstate(ios::failbit);
+            return;
         }
-        
-        // Output the hit rate
-        fout << count << ',' << traces.size() << "; ";
+        for (size_t j = 0; j < this->groups[i].size() && in; j++) this->groups[i][j]->load(in);
     }
-    
-    fout << endl;
-}
\ No newline at end of file
+
+    // Rolling stats windows start at the restored counts
+    size_t n = 0;
+    for (size_t i = 0; i < this->groups.size(); i++) {
+        for (size_t j = 0; j < this->groups[i].size(); j++, n++) {
+            this->lastHits[n] = this->groups[i][j]->hits;
+            this->lastAccesses[n] = this->groups[i][j]->simulated();
+        }
+    }
+}
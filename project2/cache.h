@@ -4,6 +4,9 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <string>
+#include <memory>
+#include "assist.h"
 
 using namespace std;
 
@@ -18,14 +21,118 @@ struct cache {
 };
 
 int log2(int base);
+int log2(unsigned long long base);
 
-void directMapped(ofstream& fout, vector<trace> traces);
-void setAssociative(ofstream& fout, vector<trace> traces);
-void fullyAssociative(ofstream& fout, vector<trace> traces);
-void fullyAssociativeLru(ofstream& fout, vector<trace> traces);
-void fullyAssociativeHotCold(ofstream& fout, vector<trace> traces);
-void setAssociativeNoAllocationWriteMiss(ofstream& fout, vector<trace> traces);
-void setAssociativeNextLinePrefetching(ofstream& fout, vector<trace> traces);
-void prefetchMiss(ofstream& fout, vector<trace> traces);
+// One simulated cache configuration, fed one access at a time
+class CacheModel {
+    public:
+        virtual ~CacheModel() {}
+        virtual bool access(const trace& t) = 0; // Returns true on a hit
+        // Accesses that hits is counted over, only the ones to sampled sets in a sweep
+        virtual unsigned long long simulated() const { return this->accesses; }
+        virtual void save(ostream& out) const = 0;
+        virtual void load(istream& in) = 0; // Sets the failbit of in if the checkpoint is of another configuration
 
-#endif // CACHE_SIM_H
\ No newline at end of file
+        unsigned long long hits = 0;     // Cache hits so far
+        unsigned long long accesses = 0; // Memory accesses so far
+};
+
+enum prefetchPolicy {
+    PREFETCH_NONE,     // Only demand accesses fill the cache
+    PREFETCH_ALWAYS,   // Next line is prefetched on every access
+    PREFETCH_ON_MISS   // Next line is prefetched on every miss
+};
+
+// Set associative cache with LRU replacement. One way gives a direct mapped
+// cache and a single set gives a fully associative one.
+class LruCache : public CacheModel {
+    public:
+        LruCache(unsigned long long cacheSize, unsigned long long lineSize, int ways, bool writeAllocate = true, prefetchPolicy prefetch = PREFETCH_NONE);
+        bool access(const trace& t);
+        void save(ostream& out) const;
+        void load(istream& in);
+        void attach(assistKind kind, int entries);
+        const AssistCache* assistCache() const { return this->assist.get(); }
+        void sample(int ratio);
+        bool isSampled() const { return this->sampledSets > 0; }
+        unsigned long long simulated() const { return isSampled() ? this->sampledAccesses : this->accesses; }
+        void estimate(double& rate, double& error) const;
+        int associativity() const { return this->ways; }
+
+        unsigned long long cacheSize;
+        unsigned long long lineSize;
+
+    private:
+        int row(unsigned long long line) const;
+        bool touch(unsigned long long line);
+        bool fill(unsigned long long line, unsigned long long& evicted);
+        void allocate(unsigned long long line);
+
+        int sets;
+        int ways;
+        int lineShift;             // log2 of the line size
+        int setShift;              // log2 of the number of sets
+        bool writeAllocate;
+        prefetchPolicy prefetch;
+        long long clock;           // Incremented on every touch, used as the LRU timestamp
+        vector<cache> table;       // sets * ways lines, one set after another
+        vector<long long> lru;     // Last touch time of each line, -1 if never used
+        unique_ptr<AssistCache> assist; // Optional victim or miss cache
+
+        // Set sampling, only a subset of the sets is simulated and the rest of the accesses are dropped
+        int sampledSets;                        // Number of sets simulated, 0 when every set is
+        vector<unsigned long long> setHits;     // Hits of each sampled set, by row
+        vector<unsigned long long> setAccesses; // Accesses of each sampled set, by row
+        unsigned long long sampledAccesses;
+};
+
+// Fully associative cache with the Hot-Cold (tree pseudo-LRU) replacement policy
+class HotColdCache : public CacheModel {
+    public:
+        HotColdCache(unsigned long long cacheSize, unsigned long long lineSize);
+        bool access(const trace& t);
+        void save(ostream& out) const;
+        void load(istream& in);
+
+    private:
+        int lines;
+        int lineShift;
+        vector<cache> table;
+        vector<bool> tree;         // Internal nodes of the Hot-Cold tree, true means the right half is colder
+};
+
+typedef vector<unique_ptr<CacheModel>> cacheGroup;
+
+// Configurations of each line of the output
+cacheGroup directMappedConfigs();
+cacheGroup setAssociativeConfigs();
+cacheGroup fullyAssociativeLruConfigs();
+cacheGroup fullyAssociativeHotColdConfigs();
+cacheGroup setAssociativeNoAllocationWriteMissConfigs();
+cacheGroup setAssociativeNextLinePrefetchingConfigs();
+cacheGroup prefetchMissConfigs();
+
+cacheGroup sampledSweepConfigs(unsigned long long cacheSize, unsigned long long lineSize, int sampleRatio);
+
+// Every configuration of the standard output, or of a set sampled sweep over
+// large caches, fed batch by batch for streaming simulation
+class CacheSuite {
+    public:
+        explicit CacheSuite(int sampleRatio = 0);
+        void attach(assistKind kind, int entries);
+        void access(const vector<trace>& batch);
+        void report(ostream& fout) const;
+        void stats(ostream& out);
+        void save(ostream& out) const;
+        void load(istream& in);
+
+    private:
+        vector<string> names;
+        vector<cacheGroup> groups;
+        bool assisted;                           // True once a victim or miss cache is attached
+        int sampleRatio;                         // One in sampleRatio sets simulated for a sweep, 0 for the standard output
+        vector<unsigned long long> lastHits;     // Hits of each configuration at the previous stats() call
+        vector<unsigned long long> lastAccesses; // Simulated accesses of each configuration at the previous stats() call
+};
+
+#endif // CACHE_SIM_H
@@ -1,29 +1,238 @@
 #include <iostream>
 #include <stdlib.h>
+#include <string>
+#include <stdio.h>
+#include <algorithm>
+#include <errno.h>
+#include <limits.h>
 #include "cache.h"
+#include "stream.h"
+#include "tlb.h"
+#include "checkpoint.h"
+#include "profile.h"
+
+const char CACHE_MAGIC[4] = {'C', 'S', 'C', 'K'};
+const unsigned long long MAX_ASSIST_ENTRIES = 1 << 16;
+const unsigned long long MAX_BATCH = 1 << 24;
+const unsigned long long MAX_SAMPLE_RATIO = 1 << 24;
+
+void usage(const char *name)
+{
+	cerr << "Usage: " << name << " [options] <trace> <output>" << endl
+	     << "  --stream          simulate while reading, <trace> may be - for stdin or a FIFO" << endl
+	     << "  --interval n      accesses between rolling stats on stderr when streaming (default 1000000, 0 for none)" << endl
+	     << "  --batch n         accesses read at a time when streaming, at most 16777216 (default 65536)" << endl
+	     << "  --victim n        attach an n line victim cache to every LRU configuration, n at most 65536" << endl
+	     << "  --miss-cache n    attach an n line miss cache to every LRU configuration, n at most 65536" << endl
+	     << "  --sweep ratio     instead of the standard configurations, estimate hit rates of 256KB to 64MB caches" << endl
+	     << "                    with 32-128 byte lines and 1-32 ways, simulating one in ratio sets (1 to 16777216);" << endl
+	     << "                    not combined with --victim or --miss-cache" << endl
+	     << "  --tlb 4k|2m|1g    translate addresses through L1/L2 TLBs and a page walk cache with pages of" << endl
+	     << "                    this size, feeding physical addresses to the caches; adds a line of" << endl
+	     << "                    L1 TLB hits,accesses; L2 TLB hits,lookups; page walks,page table references;" << endl
+	     << "  --restore file    start from a checkpoint, the trace being the next increment" << endl
+	     << "  --resume file     start from a checkpoint of this same trace, skipping what it covers" << endl
+	     << "  --checkpoint file save the simulator state at the end, and every --every accesses when streaming" << endl
+	     << "  --every n         accesses between checkpoints (default 0, only at the end)" << endl
+	     << "Checkpoints only restore into a run with the same --victim, --miss-cache, --sweep and --tlb options." << endl
+	     << "With a victim or miss cache, the output repeats every line as hits,accesses,assist hits,swaps;" << endl;
+}
+
+// Parses a whole decimal or hex option value, false unless it is a number in [low, high]
+template <typename T>
+bool parseOption(const char *arg, unsigned long long low, unsigned long long high, T& value)
+{
+	char *end;
+	errno = 0;
+	unsigned long long parsed = strtoull(arg, &end, 0);
+	if (arg[0] == '\0' || arg[0] == '-' || *end != '\0' || errno != 0 || parsed < low || parsed > high) return false;
+
+	value = (T)parsed;
+	return true;
+}
+
+// Replaces the virtual addresses of a batch with the physical addresses they translate to
+void translate(Tlb& tlb, vector<trace>& batch)
+{
+	PROFILE_SCOPE_EVENTS("tlb", batch.size());
+	for (size_t i = 0; i < batch.size(); i++)
+	{
+		batch[i].address = tlb.translate(batch[i]);
+	}
+}
+
+// Saves the state of every simulated structure after position accesses of the current trace
+bool saveCheckpoint(const string& filename, const CacheSuite& suite, const Tlb* tlb, unsigned long long position)
+{
+	PROFILE_SCOPE("checkpoint");
+	return writeCheckpointFile(filename, CACHE_MAGIC, [&](ostream& out)
+	{
+		writeValue(out, (uint64_t)position);
+		suite.save(out);
+		writeValue(out, (uint8_t)(tlb != NULL));
+		if (tlb) tlb->save(out);
+	});
+}
+
+bool loadCheckpoint(const string& filename, CacheSuite& suite, Tlb* tlb, unsigned long long& position)
+{
+	PROFILE_SCOPE("checkpoint");
+	ifstream in(filename, ios::binary);
+	uint64_t saved = 0;
+	uint8_t hasTlb = 0;
+
+	if (!readCheckpointHeader(in, CACHE_MAGIC)) return false;
+	readValue(in, saved);
+	suite.load(in);
+	readValue(in, hasTlb);
+	if (!in || (hasTlb != 0) != (tlb != NULL)) return false;
+	if (tlb) tlb->load(in);
+
+	position = saved;
+	return !in.fail();
+}
 
 int main(int argc, char *argv[])
 {
-	trace temp;
-	vector<trace> traces;
-	ifstream fin(argv[1]);
-	
-	while (fin >> temp.type >> std::hex >> temp.address)
-	{
-		traces.push_back(temp);
-	}
-	
-	fin.close();
-	
-	ofstream fout(argv[2]);
-	
-	directMapped(fout, traces);
-	setAssociative(fout, traces);
-	fullyAssociative(fout, traces);
-	setAssociativeNoAllocationWriteMiss(fout, traces);
-	setAssociativeNextLinePrefetching(fout, traces);
-	prefetchMiss(fout, traces);
-	
+	bool streaming = false;
+	unsigned long long interval = 1000000;
+	size_t batchSize = 65536;
+	int victimEntries = 0, missEntries = 0, sampleRatio = 0;
+	string pageSize, restoreFile, checkpointFile;
+	bool resume = false;
+	unsigned long long every = 0;
+	vector<string> files;
+	bool valid = true;
+
+	for (int i = 1; i < argc && valid; i++)
+	{
+		string arg = argv[i];
+		if (arg == "--stream") streaming = true;
+		else if (arg == "--interval" && i + 1 < argc) valid = parseOption(argv[++i], 0, ULLONG_MAX, interval);
+		else if (arg == "--batch" && i + 1 < argc) valid = parseOption(argv[++i], 1, MAX_BATCH, batchSize);
+		else if (arg == "--victim" && i + 1 < argc) valid = parseOption(argv[++i], 1, MAX_ASSIST_ENTRIES, victimEntries);
+		else if (arg == "--miss-cache" && i + 1 < argc) valid = parseOption(argv[++i], 1, MAX_ASSIST_ENTRIES, missEntries);
+		else if (arg == "--sweep" && i + 1 < argc) valid = parseOption(argv[++i], 1, MAX_SAMPLE_RATIO, sampleRatio);
+		else if (arg == "--tlb" && i + 1 < argc) pageSize = argv[++i];
+		else if ((arg == "--restore" || arg == "--resume") && i + 1 < argc)
+		{
+			restoreFile = argv[++i];
+			resume = arg == "--resume";
+		}
+		else if (arg == "--checkpoint" && i + 1 < argc) checkpointFile = argv[++i];
+		else if (arg == "--every" && i + 1 < argc) valid = parseOption(argv[++i], 0, ULLONG_MAX, every);
+		else if (arg.size() > 1 && arg[0] == '-' && arg != "-") valid = false;
+		else files.push_back(arg);
+	}
+
+	if (!valid || files.size() != 2 || (victimEntries > 0 && missEntries > 0) || (sampleRatio > 0 && victimEntries + missEntries > 0) || (!pageSize.empty() && pageShiftOf(pageSize) == 0))
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	ios::sync_with_stdio(false); // Lets cin buffer, so TraceStream can take whatever a pipe has ready
+
+	ifstream fin;
+	if (files[0] != "-") fin.open(files[0], ios::binary);
+	istream& in = files[0] == "-" ? cin : fin;
+	TraceStream stream(in);
+
+	if (!stream.isValid())
+	{
+		cerr << "Not a memory trace: " << files[0] << endl;
+		return 1;
+	}
+
+	ofstream fout(files[1]);
+	CacheSuite suite(sampleRatio);
+	vector<trace> batch;
+
+	unique_ptr<Tlb> tlb;
+
+	if (victimEntries > 0) suite.attach(ASSIST_VICTIM, victimEntries);
+	if (missEntries > 0) suite.attach(ASSIST_MISS, missEntries);
+	if (!pageSize.empty()) tlb.reset(new Tlb(pageShiftOf(pageSize)));
+
+	// Accesses of this trace already simulated, skipped when resuming
+	unsigned long long total = 0;
+
+	if (!restoreFile.empty())
+	{
+		unsigned long long position = 0;
+
+		if (!loadCheckpoint(restoreFile, suite, tlb.get(), position))
+		{
+			cerr << "Could not restore " << restoreFile << " (missing, damaged or of other options)" << endl;
+			return 1;
+		}
+
+		while (resume && total < position && stream.next(batch, min((unsigned long long)batchSize, position - total)) > 0)
+		{
+			total += batch.size();
+		}
+		if (resume && total < position)
+		{
+			cerr << "Could not resume " << restoreFile << ", the trace ends before its position " << position << endl;
+			return 1;
+		}
+	}
+
+	if (streaming)
+	{
+		// Feed every configuration batch by batch so memory stays bounded, publishing hit rates as we go
+		unsigned long long nextStats = total + interval, nextCheckpoint = total + every;
+
+		for (;;)
+		{
+			// Stop each batch at the next stats or checkpoint boundary so they come exactly every interval
+			unsigned long long limit = batchSize;
+			if (interval > 0) limit = min(limit, nextStats - total);
+			if (every > 0 && !checkpointFile.empty()) limit = min(limit, nextCheckpoint - total);
+			if (stream.next(batch, limit) == 0) break;
+
+			if (tlb) translate(*tlb, batch);
+			suite.access(batch);
+			total += batch.size();
+
+			if (interval > 0 && total >= nextStats)
+			{
+				suite.stats(cerr);
+				if (tlb) tlb->stats(cerr);
+				nextStats += interval;
+			}
+
+			if (every > 0 && !checkpointFile.empty() && total >= nextCheckpoint)
+			{
+				if (!saveCheckpoint(checkpointFile, suite, tlb.get(), total)) cerr << "Could not write " << checkpointFile << endl;
+				nextCheckpoint += every;
+			}
+		}
+	}
+	else
+	{
+		// Read the whole trace first, then run it through one configuration at a time
+		vector<trace> traces;
+
+		while (stream.next(batch, batchSize) > 0)
+		{
+			traces.insert(traces.end(), batch.begin(), batch.end());
+		}
+		total += traces.size();
+		if (tlb) translate(*tlb, traces);
+		suite.access(traces);
+	}
+
+	suite.report(fout);
+	if (tlb) tlb->report(fout);
 	fout.close();
+
+	if (!checkpointFile.empty() && !saveCheckpoint(checkpointFile, suite, tlb.get(), total))
+	{
+		cerr << "Could not write " << checkpointFile << endl;
+		return 1;
+	}
+
+	PROFILE_REPORT();
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,143 @@
+#include <iostream>
+#include <vector>
+#include <string.h>
+#include "stream.h"
+#include "traceio.h"
+#include "profile.h"
+
+using namespace std;
+
+const size_t READ_SIZE = 1 << 20; // Initial size of the input buffer, the most read at a time
+
+TraceStream::TraceStream(istream& in) : in(in), binary(false), valid(true), pos(0), end(0) {
+    // Text traces start with an access type or an instruction pointer, never with the binary magic.
+    // Only one character is peeked so this also works on pipes and FIFOs.
+    if (in.peek() == TRACE_MAGIC[0]) {
+        traceHeader header;
+        this->binary = true;
+        this->valid = readTraceHeader(in, TRACE_MEMORY, header);
+    }
+    this->buffer.resize(READ_SIZE);
+}
+
+// Fills batch with up to max accesses, returns how many were read (0 at the end of the input)
+size_t TraceStream::next(vector<trace>& batch, size_t max) {
+    PROFILE_SCOPE("parse");
+    batch.clear();
+    if (!this->valid) return 0;
+
+    if (this->binary) {
+        trace t;
+        memoryRecord r;
+        while (batch.size() < max) {
+            if (this->end - this->pos < sizeof(r) && !refill()) break;
+            if (this->end - this->pos < sizeof(r)) continue; // Only part of a record so far
+
+            memcpy(&r, this->buffer.data() + this->pos, sizeof(r));
+            this->pos += sizeof(r);
+            unpackMemory(r, t.type, t.address);
+            batch.push_back(t);
+        }
+        return batch.size();
+    }
+
+    const char* begin;
+    const char* lineEnd;
+    trace t;
+    while (batch.size() < max && nextLine(begin, lineEnd)) {
+        if (parseLine(begin, lineEnd, t)) batch.push_back(t);
+    }
+    return batch.size();
+}
+
+// Finds the next line in the buffer, reading more of the input when only part of a line is left
+bool TraceStream::nextLine(const char*& begin, const char*& lineEnd) {
+    for (;;) {
+        const char* start = this->buffer.data() + this->pos;
+        const char* newline = (const char*)memchr(start, '\n', this->end - this->pos);
+
+        if (newline) {
+            begin = start;
+            lineEnd = newline;
+            this->pos = newline - this->buffer.data() + 1;
+            return true;
+        }
+
+        // A last line without a newline
+        if (!refill()) {
+            if (this->pos == this->end) return false;
+            begin = this->buffer.data() + this->pos;
+            lineEnd = this->buffer.data() + this->end;
+            this->pos = this->end;
+            return true;
+        }
+    }
+}
+
+// Moves the unparsed input to the front of the buffer and reads more behind it, false at the end of the input
+bool TraceStream::refill() {
+    size_t rest = this->end - this->pos;
+    memmove(this->buffer.data(), this->buffer.data() + this->pos, rest);
+    this->pos = 0;
+    this->end = rest;
+    if (this->end == this->buffer.size()) this->buffer.resize(this->buffer.size() * 2); // Line longer than the buffer
+
+    size_t n = readAvailable(this->buffer.data() + this->end, this->buffer.size() - this->end);
+    this->end += n;
+    return n > 0;
+}
+
+// Reads up to n bytes of what the input already has, waiting only when it has nothing yet.
+// A blocking read of a whole buffer would hold back a pipe's accesses until the writer filled it.
+size_t TraceStream::readAvailable(char* dst, size_t n) {
+    streamsize got = this->in.readsome(dst, n);
+    if (got > 0) return got;
+
+    int c = this->in.get();
+    if (c == EOF) return 0;
+    dst[0] = (char)c;
+
+    got = this->in.readsome(dst + 1, n - 1);
+    return 1 + (got > 0 ? got : 0);
+}
+
+static inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Parses "[<ip>:] <type> <hex address>", returns false for lines that are not accesses
+bool TraceStream::parseLine(const char* p, const char* end, trace& t) {
+    while (p < end && isSpace(*p)) p++;
+    if (p == end) return false;
+
+    // Skip an instruction pointer token such as "0x4004d6:"
+    const char* token = p;
+    while (p < end && !isSpace(*p)) p++;
+    if (p[-1] == ':') {
+        while (p < end && isSpace(*p)) p++;
+        if (p == end) return false;
+        token = p;
+        while (p < end && !isSpace(*p)) p++;
+    }
+
+    t.type = token[0];
+    if (t.type == 'R') t.type = 'L';
+    else if (t.type == 'W') t.type = 'S';
+
+    // Read the address, with or without a 0x prefix
+    while (p < end && isSpace(*p)) p++;
+    if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) p += 2;
+
+    unsigned long long address = 0;
+    int digits = 0;
+    for (; p < end; p++, digits++) {
+        char c = *p;
+        if (c >= '0' && c <= '9') address = (address << 4) | (c - '0');
+        else if (c >= 'a' && c <= 'f') address = (address << 4) | (c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') address = (address << 4) | (c - 'A' + 10);
+        else break;
+    }
+
+    t.address = address;
+    return digits > 0;
+}
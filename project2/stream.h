@@ -0,0 +1,40 @@
+#ifndef TRACE_STREAM_H
+#define TRACE_STREAM_H
+
+#include <iostream>
+#include <vector>
+#include "cache.h"
+#include "traceio.h"
+
+using namespace std;
+
+// Reads memory accesses in batches from a file, stdin or a FIFO.
+//
+// Text traces have one access per line, "<type> <hex address>". Loads are
+// 'L' or 'R' and stores 'S' or 'W', and a leading "<ip>:" token is skipped so
+// Pin pinatrace style output can be piped in directly. Binary traces from
+// tracegen are detected by their header.
+//
+// Input is taken as it arrives rather than a whole buffer at a time, so a
+// trace piped from a running tracer is simulated while the tracer runs.
+class TraceStream {
+    public:
+        TraceStream(istream& in);
+        size_t next(vector<trace>& batch, size_t max);
+        bool isValid() const { return this->valid; }
+
+    private:
+        bool nextLine(const char*& begin, const char*& end);
+        bool refill();
+        size_t readAvailable(char* dst, size_t n);
+        static bool parseLine(const char* p, const char* end, trace& t);
+
+        istream& in;
+        bool binary;
+        bool valid;
+        vector<char> buffer; // Text or binary records read from the input
+        size_t pos;          // Start of the unparsed input in buffer
+        size_t end;          // End of the input read into buffer
+};
+
+#endif // TRACE_STREAM_H
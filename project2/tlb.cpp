@@ -0,0 +1,146 @@
+#include <iostream>
+#include <iomanip>
+#include "tlb.h"
+#include "checkpoint.h"
+#include "profile.h"
+
+using namespace std;
+
+// Span of memory mapped by one PD, PDPT and PML4 entry
+const int WALK_SHIFTS[3] = {21, 30, 39};
+const int WALK_ENTRIES[3] = {32, 4, 2}; // Entries of the page walk cache for each of those levels
+
+Tlb::Tlb(int pageShift) {
+    unsigned long long page = 1ULL << pageShift;
+
+    this->pageShift = pageShift;
+    this->nextFrame = 0;
+
+    // Sizes of a recent x86 core: separate L1 TLBs per page size and a shared 1536 entry L2 TLB
+    if (pageShift == 12) {
+        this->l1.reset(new LruCache(64 * page, page, 4));
+        this->l2.reset(new LruCache(1536 * page, page, 12));
+    }
+    else if (pageShift == 21) {
+        this->l1.reset(new LruCache(32 * page, page, 4));
+        this->l2.reset(new LruCache(1536 * page, page, 12));
+    }
+    else {
+        this->l1.reset(new LruCache(4 * page, page, 4));
+        this->l2.reset(new LruCache(16 * page, page, 4));
+    }
+
+    // Fully associative page walk caches for the levels above the leaf entries
+    for (int i = 0; i < 3; i++) {
+        if (WALK_SHIFTS[i] <= pageShift) continue;
+        this->walkCache.push_back(unique_ptr<LruCache>(new LruCache(WALK_ENTRIES[i] * (1ULL << WALK_SHIFTS[i]), 1ULL << WALK_SHIFTS[i], WALK_ENTRIES[i])));
+    }
+}
+
+// Looks up the page of an access and returns its physical address
+unsigned long long Tlb::translate(const trace& t) {
+    this->accesses++;
+
+    if (this->l1->access(t)) this->l1Hits++;
+    else if (this->l2->access(t)) this->l2Hits++;
+    else {
+        // One table level per 9 bits of the virtual page number, 4 levels for 4KB pages down to 2 for 1GB pages
+        unsigned long long references = 4 - (this->pageShift - 12) / 9;
+
+        this->walks++;
+        PROFILE_COUNT("tlb_walks", 1);
+
+        // The lowest level held in the page walk cache is where the walk can start
+        for (size_t i = 0; i < this->walkCache.size(); i++) {
+            if (this->walkCache[i]->access(t)) {
+                references = i + 1;
+                break;
+            }
+        }
+        this->walkReferences += references;
+    }
+
+    // First touch frame allocation
+    unsigned long long page = t.address >> this->pageShift;
+    unordered_map<unsigned long long, unsigned long long>::iterator it = this->frames.find(page);
+    if (it == this->frames.end()) it = this->frames.insert(make_pair(page, this->nextFrame++)).first;
+
+    return (it->second << this->pageShift) | (t.address & ((1ULL << this->pageShift) - 1));
+}
+
+// Outputs one line, "L1 TLB hits,accesses; L2 TLB hits,L2 TLB lookups; page walks,page table references;"
+void Tlb::report(ostream& fout) const {
+    PROFILE_SCOPE("output");
+    fout << this->l1Hits << ',' << this->accesses << "; "
+         << this->l2Hits << ',' << this->accesses - this->l1Hits << "; "
+         << this->walks << ',' << this->walkReferences << "; " << endl;
+}
+
+// Outputs the hit rates and walk counts so far on one line
+void Tlb::stats(ostream& out) const {
+    PROFILE_SCOPE("output");
+    unsigned long long lookups = this->accesses - this->l1Hits;
+
+    out << fixed << setprecision(4)
+        << "accesses=" << this->accesses << " tlb l1=" << (this->accesses ? (double)this->l1Hits / this->accesses : 0.0)
+        << " l2=" << (lookups ? (double)this->l2Hits / lookups : 0.0)
+        << " walks=" << this->walks << " references=" << this->walkReferences << endl
+        << defaultfloat;
+}
+
+// Saves the counts, TLB and page walk cache contents and the page to frame mapping
+void Tlb::save(ostream& out) const {
+    writeValue(out, (int32_t)this->pageShift);
+    writeValue(out, this->accesses);
+    writeValue(out, this->l1Hits);
+    writeValue(out, this->l2Hits);
+    writeValue(out, this->walks);
+    writeValue(out, this->walkReferences);
+    this->l1->save(out);
+    this->l2->save(out);
+    for (size_t i = 0; i < this->walkCache.size(); i++) this->walkCache[i]->save(out);
+
+    writeValue(out, this->nextFrame);
+    writeValue(out, (uint64_t)this->frames.size());
+    for (unordered_map<unsigned long long, unsigned long long>::const_iterator it = this->frames.begin(); it != this->frames.end(); ++it) {
+        writeValue(out, it->first);
+        writeValue(out, it->second);
+    }
+}
+
+void Tlb::load(istream& in) {
+    int32_t pageShift = 0;
+    uint64_t n = 0;
+
+    readValue(in, pageShift);
+    if (pageShift != this->pageShift) {
+        in.setstate(ios::failbit);
+        return;
+    }
+
+    readValue(in, this->accesses);
+    readValue(in, this->l1Hits);
+    readValue(in, this->l2Hits);
+    readValue(in, this->walks);
+    readValue(in, this->walkReferences);
+    this->l1->load(in);
+    this->l2->load(in);
+    for (size_t i = 0; i < this->walkCache.size(); i++) this->walkCache[i]->load(in);
+
+    readValue(in, this->nextFrame);
+    readValue(in, n);
+    this->frames.clear();
+    for (uint64_t i = 0; i < n && in; i++) {
+        unsigned long long page = 0, frame = 0;
+        readValue(in, page);
+        readValue(in, frame);
+        this->frames[page] = frame;
+    }
+}
+
+int pageShiftOf(const string& size) {
+    if (size == "4k") return 12;
+    if (size == "2m") return 21;
+    if (size == "1g") return 30;
+    return 0;
+}
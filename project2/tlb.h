@@ -0,0 +1,46 @@
+#ifndef TLB_SIM_H
+#define TLB_SIM_H
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include "cache.h"
+
+using namespace std;
+
+// Address translation in front of the cache models, treating trace addresses
+// as virtual. Every page is the same size (4KB, 2MB or 1GB) and physical
+// frames are handed out in first touch order.
+//
+// A lookup goes to the L1 TLB, then the L2 TLB, then walks the x86-64 four
+// level page table. A page walk cache holding PML4, PDPT and PD entries lets
+// a walk skip the levels it already has. The TLBs and the page walk cache
+// are LruCache models whose lines are pages (or page table regions).
+class Tlb {
+    public:
+        Tlb(int pageShift);
+        unsigned long long translate(const trace& t);
+        void report(ostream& fout) const;
+        void stats(ostream& out) const;
+        void save(ostream& out) const;
+        void load(istream& in);
+
+        unsigned long long accesses = 0;
+        unsigned long long l1Hits = 0;
+        unsigned long long l2Hits = 0;
+        unsigned long long walks = 0;
+        unsigned long long walkReferences = 0; // Page table entries read by the walks
+
+    private:
+        int pageShift;
+        unsigned long long nextFrame;
+        unordered_map<unsigned long long, unsigned long long> frames; // Virtual page number to physical frame number
+        unique_ptr<LruCache> l1;
+        unique_ptr<LruCache> l2;
+        vector<unique_ptr<LruCache>> walkCache; // Entries of PD, PDPT and PML4, in that order, that the page size needs
+};
+
+// Page shift for "4k", "2m" or "1g", 0 if the size is not supported
+int pageShiftOf(const string& size);
+
+#endif // TLB_SIM_H
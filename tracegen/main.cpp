@@ -0,0 +1,91 @@
+#include <iostream>
+#include <fstream>
+#include <stdlib.h>
+#include <string>
+#include "tracegen.h"
+
+using namespace std;
+
+void usage(const char* name) {
+    cerr << "Usage: " << name << " [options]" << endl
+         << "  -k mem|branch      trace kind (default mem)" << endl
+         << "  -p pattern         mem: stream (default), strided, random, chase, loop" << endl
+         << "                     branch: biased (default), random, correlated, loop" << endl
+         << "  -n count           number of accesses or branches (default 1000000)" << endl
+         << "  -o file            output file, - for stdout (default -)" << endl
+         << "  -b                 write the binary format instead of text" << endl
+         << "  -s seed            random seed (default 1)" << endl
+         << "  --base addr        first address, hex allowed" << endl
+         << "  --stride bytes     access stride, element or node size" << endl
+         << "  --footprint bytes  size of the memory region touched (default 1048576)" << endl
+         << "  --writes ratio     fraction of stores (default 0.3)" << endl
+         << "  --bias p           taken probability of biased branches (default 0.9)" << endl
+         << "  --branches n       number of static branches (default 64)" << endl
+         << "  --trip n           iterations of each loop level (default 8)" << endl
+         << "  --distance n       history distance of correlated branches, at least 1 (default 2)" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    genOptions opt;
+
+    // Parse the command line, every option but -b takes a value
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-b") {
+            opt.binary = true;
+            continue;
+        }
+        if (arg == "-h" || arg == "--help" || i + 1 >= argc) {
+            usage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+
+        const char* value = argv[++i];
+        if (arg == "-k") opt.kind = value;
+        else if (arg == "-p") opt.pattern = value;
+        else if (arg == "-n") opt.count = strtoull(value, NULL, 0);
+        else if (arg == "-o") opt.output = value;
+        else if (arg == "-s") opt.seed = strtoull(value, NULL, 0);
+        else if (arg == "--base") opt.base = strtoull(value, NULL, 0);
+        else if (arg == "--stride") opt.stride = strtoull(value, NULL, 0);
+        else if (arg == "--footprint") opt.footprint = strtoull(value, NULL, 0);
+        else if (arg == "--writes") opt.writeRatio = atof(value);
+        else if (arg == "--bias") opt.bias = atof(value);
+        else if (arg == "--branches") opt.branches = atoi(value);
+        else if (arg == "--trip") opt.trip = atoi(value);
+        else if (arg == "--distance") opt.distance = atoi(value);
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if ((opt.kind != "mem" && opt.kind != "branch") || opt.distance < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (opt.pattern.empty()) opt.pattern = opt.kind == "mem" ? "stream" : "biased";
+
+    ofstream fout;
+    if (opt.output != "-") {
+        fout.open(opt.output, ios::binary);
+        if (!fout) {
+            cerr << "Could not open " << opt.output << endl;
+            return 1;
+        }
+    }
+    ostream& out = opt.output == "-" ? cout : fout;
+
+    genSummary summary;
+    {
+        TraceWriter writer(out, opt.binary, opt.kind == "mem" ? TRACE_MEMORY : TRACE_BRANCH, opt.count);
+        if (opt.kind == "mem") generateMemory(opt, writer, summary);
+        else generateBranches(opt, writer, summary);
+    }
+
+    // Known totals for checking simulator output, e.g. taken is the always taken predictor's correct count
+    cerr << "events=" << summary.events() << " loads=" << summary.loads << " stores=" << summary.stores
+         << " taken=" << summary.taken << " not_taken=" << summary.notTaken << endl;
+
+    return summary.events() == opt.count ? 0 : 1;
+}
@@ -0,0 +1,252 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <string.h>
+#include <math.h>
+#include "tracegen.h"
+
+using namespace std;
+
+const size_t BUFFER_SIZE = 1 << 20; // Bytes buffered before each write to the output stream
+
+Rng::Rng(unsigned long long seed) {
+    this->state = seed ? seed : 0x9e3779b97f4a7c15ULL; // xorshift must never have an all zero state
+}
+
+unsigned long long Rng::next() {
+    this->state ^= this->state >> 12;
+    this->state ^= this->state << 25;
+    this->state ^= this->state >> 27;
+    return this->state * 0x2545f4914f6cdd1dULL;
+}
+
+// Returns a value in [0, n)
+unsigned long long Rng::below(unsigned long long n) {
+    return n ? next() % n : 0;
+}
+
+// Returns true with probability p
+bool Rng::chance(double p) {
+    return (next() >> 11) * (1.0 / 9007199254740992.0) < p;
+}
+
+TraceWriter::TraceWriter(ostream& out, bool binary, traceKind kind, unsigned long long count) : out(out), binary(binary), buffer(BUFFER_SIZE), used(0) {
+    if (binary) writeTraceHeader(out, kind, count);
+}
+
+TraceWriter::~TraceWriter() {
+    flush();
+}
+
+void TraceWriter::flush() {
+    if (this->used > 0) this->out.write(this->buffer.data(), this->used);
+    this->used = 0;
+    this->out.flush();
+}
+
+// Makes sure there is room for the next record in the buffer
+void TraceWriter::reserve(size_t bytes) {
+    if (this->used + bytes > this->buffer.size()) {
+        this->out.write(this->buffer.data(), this->used);
+        this->used = 0;
+    }
+}
+
+// Writes "0x" followed by the lowercase hex digits of value, returns the new end of the buffer
+static char* appendHex(char* p, unsigned long long value) {
+    char digits[16];
+    int n = 0;
+    do {
+        digits[n++] = "0123456789abcdef"[value & 0xf];
+        value >>= 4;
+    } while (value);
+
+    *p++ = '0';
+    *p++ = 'x';
+    while (n > 0) *p++ = digits[--n];
+    return p;
+}
+
+// Memory records are "L 0x<address>" or "S 0x<address>" in text form, the format main.cpp in project2 reads
+void TraceWriter::memory(char type, unsigned long long address) {
+    if (this->binary) {
+        memoryRecord r = packMemory(type, address);
+        reserve(sizeof(r));
+        memcpy(&this->buffer[this->used], &r, sizeof(r));
+        this->used += sizeof(r);
+        return;
+    }
+
+    reserve(24);
+    char* start = &this->buffer[this->used];
+    char* p = start;
+    *p++ = type;
+    *p++ = ' ';
+    p = appendHex(p, address);
+    *p++ = '\n';
+    this->used += p - start;
+}
+
+// Branch records are "0x<address> T|NT 0x<target>" in text form, the format Predictor.cpp in project1 reads
+void TraceWriter::branch(unsigned long long address, bool taken, unsigned long long target) {
+    if (this->binary) {
+        branchRecord r = packBranch(address, taken, target);
+        reserve(sizeof(r));
+        memcpy(&this->buffer[this->used], &r, sizeof(r));
+        this->used += sizeof(r);
+        return;
+    }
+
+    reserve(48);
+    char* start = &this->buffer[this->used];
+    char* p = start;
+    p = appendHex(p, address);
+    *p++ = ' ';
+    if (!taken) *p++ = 'N';
+    *p++ = 'T';
+    *p++ = ' ';
+    p = appendHex(p, target);
+    *p++ = '\n';
+    this->used += p - start;
+}
+
+// Generates a memory trace:
+//   stream   - sequential accesses of stride bytes (default 4) wrapping around the footprint
+//   strided  - the same with a larger stride (default 256)
+//   random   - uniformly random stride aligned accesses within the footprint
+//   chase    - pointer chasing through a random cycle over stride sized nodes (default 64)
+//   loop     - the i/j/k loop nest of a matrix multiply C += A * B sized to fit the footprint
+void generateMemory(const genOptions& opt, TraceWriter& writer, genSummary& summary) {
+    Rng rng(opt.seed);
+    unsigned long long base = opt.base ? opt.base : 0x10000000ULL;
+    unsigned long long stride = opt.stride;
+    if (stride == 0) {
+        if (opt.pattern == "strided") stride = 256;
+        else if (opt.pattern == "chase") stride = 64;
+        else stride = 4;
+    }
+    unsigned long long slots = opt.footprint / stride; // Number of stride sized slots in the footprint
+    if (slots == 0) slots = 1;
+
+    if (opt.pattern == "stream" || opt.pattern == "strided") {
+        for (unsigned long long i = 0; i < opt.count; i++) {
+            char type = rng.chance(opt.writeRatio) ? 'S' : 'L';
+            writer.memory(type, base + (i % slots) * stride);
+            if (type == 'S') summary.stores++;
+            else summary.loads++;
+        }
+    }
+    else if (opt.pattern == "random") {
+        for (unsigned long long i = 0; i < opt.count; i++) {
+            char type = rng.chance(opt.writeRatio) ? 'S' : 'L';
+            writer.memory(type, base + rng.below(slots) * stride);
+            if (type == 'S') summary.stores++;
+            else summary.loads++;
+        }
+    }
+    else if (opt.pattern == "chase") {
+        // Sattolo's algorithm gives a single cycle through every node, so the chase never gets stuck in a short loop
+        vector<unsigned int> next(slots);
+        for (unsigned long long i = 0; i < slots; i++) next[i] = i;
+        for (unsigned long long i = slots - 1; i > 0; i--) swap(next[i], next[rng.below(i)]);
+
+        unsigned long long node = 0;
+        for (unsigned long long i = 0; i < opt.count; i++) {
+            char type = rng.chance(opt.writeRatio) ? 'S' : 'L';
+            writer.memory(type, base + node * stride);
+            if (type == 'S') summary.stores++;
+            else summary.loads++;
+            node = next[node];
+        }
+    }
+    else if (opt.pattern == "loop") {
+        // Three n x n matrices of stride byte elements laid out one after another
+        unsigned long long n = sqrt((double)opt.footprint / (3 * stride));
+        if (n == 0) n = 1;
+        unsigned long long a = base, b = a + n * n * stride, c = b + n * n * stride;
+        unsigned long long i = 0, j = 0, k = 0;
+
+        while (summary.events() < opt.count) {
+            writer.memory('L', a + (i * n + k) * stride);
+            summary.loads++;
+            if (summary.events() == opt.count) break;
+            writer.memory('L', b + (k * n + j) * stride);
+            summary.loads++;
+
+            // Store C[i][j] once the inner product is done, then step the loop counters
+            if (++k == n) {
+                k = 0;
+                if (summary.events() == opt.count) break;
+                writer.memory('S', c + (i * n + j) * stride);
+                summary.stores++;
+                if (++j == n) {
+                    j = 0;
+                    if (++i == n) i = 0;
+                }
+            }
+        }
+    }
+    else {
+        cerr << "Unknown memory pattern: " << opt.pattern << endl;
+    }
+}
+
+// Generates a branch trace over opt.branches static branches executed in program order:
+//   biased     - every branch is taken with probability bias
+//   random     - every branch is taken with probability 0.5
+//   correlated - the first distance branches of each pass are random, every later one repeats the
+//                outcome of the branch distance positions before it (learnable with enough history)
+//   loop       - the back edges of a two level loop nest, each running trip iterations
+void generateBranches(const genOptions& opt, TraceWriter& writer, genSummary& summary) {
+    Rng rng(opt.seed);
+    unsigned long long base = opt.base ? opt.base : 0x400000ULL;
+    int branches = opt.branches > 0 ? opt.branches : 1;
+    vector<bool> outcomes(branches, false); // Outcomes of the current pass, used by the correlated pattern
+
+    if (opt.pattern == "loop") {
+        unsigned long long inner = base, outer = base + 0x40;
+        int trip = opt.trip > 0 ? opt.trip : 1;
+        int i = 0, j = 0;
+
+        while (summary.events() < opt.count) {
+            bool taken = ++j < trip;
+            writer.branch(inner, taken, inner - 0x20);
+            if (taken) summary.taken++;
+            else summary.notTaken++;
+
+            // The outer back edge runs once every time the inner loop falls through
+            if (!taken && summary.events() < opt.count) {
+                j = 0;
+                taken = ++i < trip;
+                writer.branch(outer, taken, outer - 0x60);
+                if (taken) summary.taken++;
+                else {
+                    summary.notTaken++;
+                    i = 0;
+                }
+            }
+        }
+        return;
+    }
+
+    if (opt.pattern != "biased" && opt.pattern != "random" && opt.pattern != "correlated") {
+        cerr << "Unknown branch pattern: " << opt.pattern << endl;
+        return;
+    }
+
+    for (unsigned long long i = 0; i < opt.count; i++) {
+        int b = i % branches;
+        unsigned long long pc = base + b * 12;
+        bool taken;
+
+        if (opt.pattern == "biased") taken = rng.chance(opt.bias);
+        else if (opt.pattern == "correlated" && b >= opt.distance) taken = outcomes[b - opt.distance];
+        else taken = rng.chance(0.5);
+
+        outcomes[b] = taken;
+        writer.branch(pc, taken, pc + 0x40 + (b % 8) * 4);
+        if (taken) summary.taken++;
+        else summary.notTaken++;
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef TRACEGEN_H
+#define TRACEGEN_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "traceio.h"
+
+using namespace std;
+
+// Generator settings, filled in from the command line
+struct genOptions {
+    string kind = "mem";          // "mem" for cache_sim traces, "branch" for predictors traces
+    string pattern;               // Empty picks stream for memory traces and biased for branch traces
+    string output = "-";          // "-" writes to stdout
+    bool binary = false;
+    unsigned long long count = 1000000;
+    unsigned long long seed = 1;
+    unsigned long long base = 0;  // 0 picks a default base address for the kind
+    unsigned long long stride = 0; // 0 picks a default stride for the pattern
+    unsigned long long footprint = 1 << 20;
+    double writeRatio = 0.3;      // Fraction of stores for the memory patterns
+    double bias = 0.9;            // Taken probability for biased branches
+    int branches = 64;            // Number of static branches
+    int trip = 8;                 // Inner trip count for loop branches
+    int distance = 2;             // History distance for correlated branches
+};
+
+// Totals of what was generated, printed so the simulators' outputs can be checked against them
+struct genSummary {
+    unsigned long long loads = 0;
+    unsigned long long stores = 0;
+    unsigned long long taken = 0;
+    unsigned long long notTaken = 0;
+
+    unsigned long long events() const { return loads + stores + taken + notTaken; }
+};
+
+// xorshift64* generator, so traces are identical for a seed on every platform
+class Rng {
+    public:
+        Rng(unsigned long long seed);
+        unsigned long long next();
+        unsigned long long below(unsigned long long n);
+        bool chance(double p);
+
+    private:
+        unsigned long long state;
+};
+
+// Buffered writer for the text and binary trace formats
+class TraceWriter {
+    public:
+        TraceWriter(ostream& out, bool binary, traceKind kind, unsigned long long count);
+        ~TraceWriter();
+        void memory(char type, unsigned long long address);
+        void branch(unsigned long long address, bool taken, unsigned long long target);
+        void flush();
+
+    private:
+        void reserve(size_t bytes);
+
+        ostream& out;
+        bool binary;
+        vector<char> buffer;
+        size_t used;
+};
+
+void generateMemory(const genOptions& opt, TraceWriter& writer, genSummary& summary);
+void generateBranches(const genOptions& opt, TraceWriter& writer, genSummary& summary);
+
+#endif // TRACEGEN_H